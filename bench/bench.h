@@ -0,0 +1,126 @@
+#ifndef bench_H
+#define bench_H
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Minimum time a measurement runs for, and the number of measurements of
+// which the fastest is reported.
+#define BENCH_MIN_NS 20000000.0
+#define BENCH_REPEAT 3
+
+static const size_t bench_sizes[] = {
+	8, 64, 512, 4096, 32768, 262144, 2097152, 16777216, 67108864,
+};
+
+#define BENCH_SIZES_FOREACH(n) \
+	for (size_t bench_i_=0; bench_i_<sizeof(bench_sizes)/sizeof(*bench_sizes) \
+		&& ((n) = bench_sizes[bench_i_]) <= bench_max(); ++bench_i_)
+
+// Results are accumulated here so calls can't be optimized away.
+volatile size_t bench_sink;
+
+// Largest input size, lowered with the BENCH_MAX environment variable.
+size_t
+bench_max(void)
+{
+	const char *env = getenv("BENCH_MAX");
+
+	return env ? strtoull(env, NULL, 10) : 67108864;
+}
+
+double
+bench_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Time stamp counter, which counts reference cycles at a fixed rate rather
+// than the cycles of the core. Returns 0 where there is none.
+uint64_t
+bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+void *
+bench_alloc(size_t n)
+{
+	void *mem = malloc(n ? n : 1);
+
+	if (!mem) {
+		fprintf(stderr, "bench: out of memory\n");
+		exit(1);
+	}
+
+	return mem;
+}
+
+// Fill "mem" with words of random lower case letters separated by spaces.
+void
+bench_text(char *mem, size_t n)
+{
+	for (size_t i=0; i<n; ++i) {
+		mem[i] = rand() % 6 ? 'a' + rand() % 26 : ' ';
+	}
+}
+
+/**
+ * Measure "fn" called on "arg" with an input of "bytes" bytes, and print a
+ * CSV line of the function, its implementation, the input size, the number
+ * of calls timed, ns per call, bytes per cycle and GB/s.
+ */
+void
+bench_run(const char *fun, const char *impl, size_t bytes,
+	size_t (*fn)(void *), void *arg)
+{
+	double best = 0;
+	uint64_t cycles = 0;
+	size_t iters = 1;
+	size_t i;
+	int r;
+
+	// Double the number of calls until they take long enough to time.
+	for (;;) {
+		double t = bench_ns();
+
+		for (i=0; i<iters; ++i)
+			bench_sink += fn(arg);
+
+		if (bench_ns() - t >= BENCH_MIN_NS)
+			break;
+		iters *= 2;
+	}
+
+	for (r=0; r<BENCH_REPEAT; ++r) {
+		uint64_t c = bench_cycles();
+		double t = bench_ns();
+
+		for (i=0; i<iters; ++i)
+			bench_sink += fn(arg);
+
+		t = bench_ns() - t;
+		c = bench_cycles() - c;
+
+		if (!r || t < best) {
+			best = t;
+			cycles = c;
+		}
+	}
+
+	printf("%s,%s,%zu,%zu,%.3f,%.4f,%.4f\n", fun, impl, bytes, iters,
+		best / iters, cycles ? (double)bytes * iters / cycles : 0.0,
+		(double)bytes * iters / best);
+	fflush(stdout);
+}
+
+#endif
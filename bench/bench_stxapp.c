@@ -0,0 +1,51 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../libstx.h"
+#include "bench.h"
+
+static stx s1;
+static spx src;
+
+static size_t
+app(void *arg)
+{
+	(void)arg;
+	s1.len = 0;
+	return stxapp_spx(&s1, src)->len;
+}
+
+static size_t
+libc(void *arg)
+{
+	(void)arg;
+	memcpy(s1.mem, src.mem, src.len);
+	return src.len;
+}
+
+int
+main(void)
+{
+	size_t n;
+	char *mem = bench_alloc(bench_max());
+
+	stxalloc(&s1, bench_max());
+
+	// Appending to an empty stx with enough room.
+	BENCH_SIZES_FOREACH(n) {
+		bench_text(mem, n);
+		src.mem = mem;
+		src.len = n;
+
+		bench_run("stxapp", "stxapp_spx", n, app, NULL);
+		bench_run("stxapp", "memcpy", n, libc, NULL);
+	}
+
+	stxfree(&s1);
+	free(mem);
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../libstx.h"
+#include "bench.h"
+
+static spx s1;
+static spx s2;
+
+static size_t
+cmp(void *arg)
+{
+	(void)arg;
+	return stxcmp(s1, s2);
+}
+
+static size_t
+icmp(void *arg)
+{
+	(void)arg;
+	return stxicmp(s1, s2);
+}
+
+static size_t
+libc(void *arg)
+{
+	(void)arg;
+	return s1.len == s2.len && 0 == memcmp(s1.mem, s2.mem, s1.len);
+}
+
+int
+main(void)
+{
+	size_t n;
+	char *m1 = bench_alloc(bench_max());
+	char *m2 = bench_alloc(bench_max());
+
+	// Equal contents, which are compared whole.
+	BENCH_SIZES_FOREACH(n) {
+		bench_text(m1, n);
+		memcpy(m2, m1, n);
+		s1.mem = m1;
+		s1.len = n;
+		s2.mem = m2;
+		s2.len = n;
+
+		bench_run("stxcmp", "stxcmp", n, cmp, NULL);
+		bench_run("stxcmp", "stxicmp", n, icmp, NULL);
+		bench_run("stxcmp", "memcmp", n, libc, NULL);
+	}
+
+	free(m1);
+	free(m2);
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../libstx.h"
+#include "bench.h"
+
+static const char needle[] = "Needle";
+static spx hay;
+
+static size_t
+find(void *arg)
+{
+	(void)arg;
+	return stxfind_mem(hay, needle, sizeof(needle) - 1).len;
+}
+
+static size_t
+ifind(void *arg)
+{
+	(void)arg;
+	return stxifind_mem(hay, needle, sizeof(needle) - 1).len;
+}
+
+static size_t
+libc(void *arg)
+{
+	(void)arg;
+	return memmem(hay.mem, hay.len, needle, sizeof(needle) - 1) != NULL;
+}
+
+int
+main(void)
+{
+	size_t n;
+	char *mem = bench_alloc(bench_max());
+
+	// The needle is at the end of the text, which is searched whole.
+	BENCH_SIZES_FOREACH(n) {
+		bench_text(mem, n);
+		if (n >= sizeof(needle) - 1)
+			memcpy(mem + n - (sizeof(needle) - 1), needle, sizeof(needle) - 1);
+		hay.mem = mem;
+		hay.len = n;
+
+		bench_run("stxfind", "stxfind_mem", n, find, NULL);
+		bench_run("stxfind", "stxifind_mem", n, ifind, NULL);
+		bench_run("stxfind", "memmem", n, libc, NULL);
+	}
+
+	free(mem);
+
+	return 0;
+}
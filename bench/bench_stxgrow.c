@@ -0,0 +1,58 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../libstx.h"
+#include "bench.h"
+
+static size_t size;
+
+static size_t
+grow(void *arg)
+{
+	stx s1;
+	size_t n;
+
+	(void)arg;
+
+	stxalloc(&s1, 8);
+	stxgrow(&s1, size);
+	n = s1.size;
+	stxfree(&s1);
+
+	return n;
+}
+
+static size_t
+libc(void *arg)
+{
+	char *mem = malloc(8);
+	char *tmp = realloc(mem, 8 + size);
+
+	(void)arg;
+
+	if (tmp)
+		mem = tmp;
+	free(mem);
+
+	return tmp != NULL;
+}
+
+int
+main(void)
+{
+	size_t n;
+
+	// Growing a small stx to the size, which is as costly as the allocator
+	// makes it.
+	BENCH_SIZES_FOREACH(n) {
+		size = n;
+
+		bench_run("stxgrow", "stxgrow", n, grow, NULL);
+		bench_run("stxgrow", "realloc", n, libc, NULL);
+	}
+
+	return 0;
+}
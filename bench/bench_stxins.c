@@ -0,0 +1,50 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../libstx.h"
+#include "bench.h"
+
+static const char word[8] = "inserted";
+static stx s1;
+static size_t len;
+
+static size_t
+ins(void *arg)
+{
+	(void)arg;
+	s1.len = len;
+	return stxins_mem(&s1, 0, word, sizeof(word))->len;
+}
+
+static size_t
+libc(void *arg)
+{
+	(void)arg;
+	memmove(s1.mem + sizeof(word), s1.mem, len);
+	memcpy(s1.mem, word, sizeof(word));
+	return len + sizeof(word);
+}
+
+int
+main(void)
+{
+	size_t n;
+
+	stxalloc(&s1, bench_max() + sizeof(word));
+
+	// Inserting at the front moves the whole contents.
+	BENCH_SIZES_FOREACH(n) {
+		bench_text(s1.mem, n);
+		len = n;
+
+		bench_run("stxins", "stxins_mem", n, ins, NULL);
+		bench_run("stxins", "memmove", n, libc, NULL);
+	}
+
+	stxfree(&s1);
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../libstx.h"
+#include "bench.h"
+
+static const char ws[] = " \t\r\n";
+static stx s1;
+static size_t len;
+
+static size_t
+rstrip(void *arg)
+{
+	(void)arg;
+
+	// Only the length changes, so the input is restored for free.
+	s1.len = len;
+	return stxrstrip(&s1, ws, sizeof(ws) - 1)->len;
+}
+
+static size_t
+libc(void *arg)
+{
+	(void)arg;
+	return strspn(s1.mem + 1, ws);
+}
+
+int
+main(void)
+{
+	size_t n;
+
+	stxalloc(&s1, bench_max() + 1);
+
+	// A single letter followed by white space to strip, and null terminated
+	// for strspn().
+	BENCH_SIZES_FOREACH(n) {
+		size_t i;
+
+		s1.mem[0] = 'x';
+		for (i=1; i<n; ++i)
+			s1.mem[i] = ws[rand() % (sizeof(ws) - 1)];
+		s1.mem[n] = '\0';
+		len = n;
+
+		bench_run("stxstrip", "stxrstrip", n, rstrip, NULL);
+		bench_run("stxstrip", "strspn", n, libc, NULL);
+	}
+
+	stxfree(&s1);
+
+	return 0;
+}
@@ -0,0 +1,92 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../libstx.h"
+#include "bench.h"
+
+static spx text;
+
+static size_t
+tok(void *arg)
+{
+	spx rest = text;
+	size_t n = 0;
+
+	(void)arg;
+
+	// Without a separator left, the rest is returned and not consumed.
+	while (rest.len) {
+		spx t = stxtok(&rest, " ", 1);
+
+		++n;
+		if (t.mem == rest.mem)
+			break;
+	}
+
+	return n;
+}
+
+static size_t
+libc(void *arg)
+{
+	const char *p = text.mem;
+	size_t len = text.len;
+	size_t n = 0;
+
+	(void)arg;
+
+	while (len) {
+		const char *sep = memchr(p, ' ', len);
+
+		++n;
+		if (!sep)
+			break;
+		len -= sep + 1 - p;
+		p = sep + 1;
+	}
+
+	return n;
+}
+
+static size_t
+libcspn(void *arg)
+{
+	const char *p = text.mem;
+	size_t n = 0;
+
+	(void)arg;
+
+	// The text is null terminated for this one.
+	while (*p) {
+		p += strcspn(p, " ");
+		p += strspn(p, " ");
+		++n;
+	}
+
+	return n;
+}
+
+int
+main(void)
+{
+	size_t n;
+	char *mem = bench_alloc(bench_max() + 1);
+
+	BENCH_SIZES_FOREACH(n) {
+		bench_text(mem, n);
+		mem[n] = '\0';
+		text.mem = mem;
+		text.len = n;
+
+		bench_run("stxtok", "stxtok", n, tok, NULL);
+		bench_run("stxtok", "memchr", n, libc, NULL);
+		bench_run("stxtok", "strcspn", n, libcspn, NULL);
+	}
+
+	free(mem);
+
+	return 0;
+}
@@ -0,0 +1,64 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../libstx.h"
+#include "bench.h"
+
+static spx text;
+
+static size_t
+utf8len(void *arg)
+{
+	(void)arg;
+	return stxutf8len(text);
+}
+
+// Count the bytes that don't continue an encoding.
+static size_t
+loop(void *arg)
+{
+	size_t n = 0;
+	size_t i;
+
+	(void)arg;
+
+	for (i=0; i<text.len; ++i)
+		n += (text.mem[i] & 0xc0) != 0x80;
+
+	return n;
+}
+
+int
+main(void)
+{
+	static const uint32_t cps[] = {'a', ' ', 0xe9, 0x3b1, 0x4e2d, 0x1f600};
+	size_t n;
+	char *mem = bench_alloc(bench_max());
+
+	// Mostly ASCII text with some 2, 3 and 4 byte encodings.
+	BENCH_SIZES_FOREACH(n) {
+		size_t i = 0;
+
+		while (i < n) {
+			uint32_t wc = cps[rand() % 4 ? 0 : rand() % 6];
+			size_t len = stxutf8n32(wc);
+
+			if (i + len > n)
+				wc = 'a', len = 1;
+			stxutf8f32(mem + i, wc, len);
+			i += len;
+		}
+		text.mem = mem;
+		text.len = n;
+
+		bench_run("stxutf", "stxutf8len", n, utf8len, NULL);
+		bench_run("stxutf", "loop", n, loop, NULL);
+	}
+
+	free(mem);
+
+	return 0;
+}
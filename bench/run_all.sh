@@ -0,0 +1,16 @@
+#!/bin/sh
+# This script runs all benchmarks, printing their results as CSV.
+# Returns -1 if a benchmark fails, 0 otherwise.
+
+BENCH_DIR=$(dirname $(realpath $0))
+
+printf -- "function,impl,bytes,iters,ns_per_op,bytes_per_cycle,gb_per_s\n"
+
+for i in "$BENCH_DIR"/*.bench; do
+	"$i"
+	if ! [ $? -eq 0 ]; then
+		exit -1
+	fi
+done
+
+exit 0
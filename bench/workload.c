@@ -0,0 +1,399 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "../libstx.h"
+#include "bench.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/**
+ * End to end workloads: synthetic corpora run through parse, transform and
+ * format pipelines made of libstx calls. Each prints a CSV line with its wall
+ * clock time and, where perf_event_open() is permitted, hardware counters of
+ * the user space part of the run.
+ */
+
+enum {
+	CYCLES,
+	INSTRUCTIONS,
+	CACHE_MISSES,
+	BRANCH_MISSES,
+	COUNTERS,
+};
+
+static int counters[COUNTERS] = {-1, -1, -1, -1};
+
+static const char *
+pick(const char *const *list, size_t n)
+{
+	return list[rand() % n];
+}
+
+#define PICK(list) pick(list, sizeof(list) / sizeof(*list))
+
+static void
+gen_log(stx *sp, size_t size)
+{
+	static const char *const paths[] = {
+		"/", "/index.html", "/api/v1/users", "/static/app.js",
+		"/images/logo.png", "/search?q=libstx&page=2",
+	};
+	static const char *const agents[] = {
+		"Mozilla/5.0 (X11; Linux x86_64)", "curl/8.4.0",
+		"MOZILLA/5.0 (Windows NT 10.0)", "Googlebot/2.1",
+	};
+	static const int statuses[] = {200, 200, 200, 301, 304, 404, 500};
+
+	while (sp->len + 256 < size) {
+		stxappf(sp, "10.%d.%d.%d - - [19/Oct/2026:10:%02d:%02d +0000] "
+			"\"GET %s HTTP/1.1\" %d %d \"%s\"\n",
+			rand() % 256, rand() % 256, rand() % 256, rand() % 60,
+			rand() % 60, PICK(paths),
+			statuses[rand() % (sizeof(statuses) / sizeof(*statuses))],
+			rand() % 100000, PICK(agents));
+	}
+}
+
+static void
+gen_csv(stx *sp, size_t size)
+{
+	static const char *const names[] = {
+		"widget", "gadget", "sprocket", "gizmo", "doohickey",
+	};
+	uint64_t id = 0;
+
+	while (sp->len + 128 < size) {
+		stxappf(sp, "%llu,%s,%d.%02d,%d\n", (unsigned long long)id++,
+			PICK(names), rand() % 1000, rand() % 100, rand() % 50);
+	}
+}
+
+static void
+gen_json(stx *sp, size_t size)
+{
+	static const char *const names[] = {
+		"Alice", "BOB", "carol", "Dave", "EVE",
+	};
+
+	while (sp->len + 128 < size) {
+		stxappf(sp, "{\"id\":%d,\"name\":\"%s\",\"score\":%d.%d,"
+			"\"tags\":[\"a\",\"b\"]}\n", rand(), PICK(names),
+			rand() % 100, rand() % 1000);
+	}
+}
+
+static void
+gen_utf8(stx *sp, size_t size)
+{
+	static const char *const words[] = {
+		"hello", "wörld", "naïve", "καλημέρα", "日本語", "текст",
+		"emoji😀", "  ", "café",
+	};
+	size_t i;
+
+	while (sp->len + 128 < size) {
+		for (i=1 + rand() % 12; i; --i) {
+			stxapp_str(sp, PICK(words));
+			stxapp_str(sp, " ");
+		}
+		stxapp_str(sp, "\n");
+	}
+}
+
+// Count log lines by status class, count the ones from a Mozilla user agent
+// and write out the address and status of the errors.
+static size_t
+run_log(const spx corpus, stx *out)
+{
+	static const spx sp = {.mem = " ", .len = 1};
+	spx rest = corpus;
+	size_t classes[6] = {0};
+	size_t mozilla = 0;
+
+	out->len = 0;
+
+	while (rest.len) {
+		spx line = stxtok(&rest, "\n", 1);
+		spx fields = line;
+		spx ip = stxtok(&fields, sp.mem, sp.len);
+		spx quote = stxfind_str(fields, "\" ");
+		uint64_t status = 0;
+
+		if (!quote.mem)
+			break;
+
+		fields = stxslice(fields, quote.mem + 2 - fields.mem, fields.len);
+		stxtou64(fields, &status);
+		++classes[status / 100 % 6];
+
+		if (stxifind_str(line, "mozilla").mem)
+			++mozilla;
+
+		if (status >= 400) {
+			stxapp_spx(out, ip);
+			stxapp_str(out, " ");
+			stxapp_u64(out, status);
+			stxapp_str(out, "\n");
+		}
+
+		if (line.mem == rest.mem)
+			break;
+	}
+
+	return classes[2] + classes[4] + classes[5] + mozilla + out->len;
+}
+
+// Total the price times quantity of each CSV row, and write each row back
+// with its fields reversed.
+static size_t
+run_csv(const spx corpus, stx *out)
+{
+	static const spx comma = {.mem = ",", .len = 1};
+	spx rest = corpus;
+	double total = 0;
+
+	out->len = 0;
+
+	while (rest.len) {
+		spx line = stxtok(&rest, "\n", 1);
+		spx fields[4];
+		spx rev[4];
+		double price;
+		uint64_t qty;
+		size_t i;
+
+		for (i=0; i<4; ++i)
+			fields[i] = stxtok(&line, comma.mem, comma.len);
+
+		stxtod(fields[2], &price);
+		stxtou64(fields[3], &qty);
+		total += price * qty;
+
+		for (i=0; i<4; ++i)
+			rev[i] = fields[3 - i];
+		stxjoin(out, rev, 4, comma);
+		stxapp_str(out, "\n");
+
+		if (fields[0].mem == rest.mem)
+			break;
+	}
+
+	stxapp_f64(out, total);
+
+	return out->len;
+}
+
+// Pull the name and score out of each JSON-ish record, normalizing the case
+// of the name, and write them as "name=score" lines.
+static size_t
+run_json(const spx corpus, stx *out)
+{
+	spx rest = corpus;
+	stx name;
+
+	out->len = 0;
+	stxalloc(&name, 64);
+
+	while (rest.len) {
+		spx line = stxtok(&rest, "\n", 1);
+		spx at = stxfind_str(line, "\"name\":\"");
+		spx val;
+		double score;
+
+		if (!at.mem)
+			break;
+
+		val = stxslice(line, at.mem + at.len - line.mem, line.len);
+		val = stxtok(&val, "\"", 1);
+		stxtolower_spx(&name, val);
+
+		at = stxfind_str(line, "\"score\":");
+		val = stxslice(line, at.mem + at.len - line.mem, line.len);
+		stxtod(val, &score);
+
+		stxapp_spx(out, stxref(&name));
+		stxapp_str(out, "=");
+		stxapp_f64(out, score);
+		stxapp_str(out, "\n");
+
+		if (line.mem == rest.mem)
+			break;
+	}
+
+	stxfree(&name);
+
+	return out->len;
+}
+
+// Count the code points of each stripped line of text, and write it upper
+// cased.
+static size_t
+run_utf8(const spx corpus, stx *out)
+{
+	spx rest = corpus;
+	size_t chars = 0;
+	stx line;
+
+	out->len = 0;
+	stxalloc(&line, 4096);
+
+	while (rest.len) {
+		spx tok = stxtok(&rest, "\n", 1);
+
+		stxcpy_spx(&line, tok);
+		stxstrip(&line, " ", 1);
+		chars += stxutf8len(stxref(&line));
+		stxapp_spx(out, stxref(stxtoupper(&line)));
+		stxapp_str(out, "\n");
+
+		if (tok.mem == rest.mem)
+			break;
+	}
+
+	stxfree(&line);
+
+	return chars + out->len;
+}
+
+#ifdef __linux__
+static void
+perf_open(void)
+{
+	static const uint64_t configs[COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES,
+	};
+	struct perf_event_attr attr;
+	int i;
+
+	// Counting user space only is allowed at the default paranoia level.
+	for (i=0; i<COUNTERS; ++i) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = configs[i];
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		counters[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+}
+
+static void
+perf_start(void)
+{
+	int i;
+
+	for (i=0; i<COUNTERS; ++i) {
+		if (-1 != counters[i]) {
+			ioctl(counters[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(counters[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+static void
+perf_stop(uint64_t *values)
+{
+	int i;
+
+	for (i=0; i<COUNTERS; ++i) {
+		values[i] = 0;
+		if (-1 != counters[i]) {
+			ioctl(counters[i], PERF_EVENT_IOC_DISABLE, 0);
+			if (sizeof(values[i]) != read(counters[i], values + i, sizeof(values[i])))
+				values[i] = 0;
+		}
+	}
+}
+#else
+static void perf_open(void) {}
+static void perf_start(void) {}
+static void
+perf_stop(uint64_t *values)
+{
+	memset(values, 0, COUNTERS * sizeof(*values));
+}
+#endif
+
+// Print a counter, or nothing if it couldn't be read.
+static void
+print_counter(int i, uint64_t value)
+{
+	if (-1 == counters[i])
+		printf(",");
+	else
+		printf(",%llu", (unsigned long long)value);
+}
+
+static void
+run(const char *name, void (*gen)(stx *, size_t),
+	size_t (*pipeline)(const spx, stx *), size_t size)
+{
+	uint64_t values[COUNTERS];
+	stx corpus;
+	stx out;
+	double t;
+
+	srand(1);
+	stxalloc(&corpus, size);
+	stxalloc(&out, size);
+	gen(&corpus, size);
+
+	// Warm up the caches and grow the output once.
+	bench_sink += pipeline(stxref(&corpus), &out);
+
+	perf_start();
+	t = bench_ns();
+	bench_sink += pipeline(stxref(&corpus), &out);
+	t = bench_ns() - t;
+	perf_stop(values);
+
+	printf("%s,%zu,%.0f,%.2f", name, corpus.len, t, corpus.len * 1e3 / t);
+	print_counter(CYCLES, values[CYCLES]);
+	print_counter(INSTRUCTIONS, values[INSTRUCTIONS]);
+	if (-1 != counters[CYCLES] && -1 != counters[INSTRUCTIONS] && values[CYCLES])
+		printf(",%.3f", (double)values[INSTRUCTIONS] / values[CYCLES]);
+	else
+		printf(",");
+	print_counter(CACHE_MISSES, values[CACHE_MISSES]);
+	print_counter(BRANCH_MISSES, values[BRANCH_MISSES]);
+	printf("\n");
+	fflush(stdout);
+
+	stxfree(&corpus);
+	stxfree(&out);
+}
+
+int
+main(void)
+{
+	const char *env = getenv("WORKLOAD_SIZE");
+	size_t size = env ? strtoull(env, NULL, 10) : 33554432;
+
+	perf_open();
+	if (-1 == counters[CYCLES])
+		fprintf(stderr, "workload: hardware counters unavailable, "
+			"timing with the wall clock only\n");
+
+	printf("workload,bytes,ns,mb_per_s,cycles,instructions,ipc,"
+		"cache_misses,branch_misses\n");
+
+	run("access_log", gen_log, run_log, size);
+	run("csv", gen_csv, run_csv, size);
+	run("json", gen_json, run_json, size);
+	run("utf8", gen_utf8, run_utf8, size);
+
+	return 0;
+}
@@ -7,8 +7,12 @@ LIBPREFIX = ${PREFIX}/lib
 INCLUDEPREFIX = ${PREFIX}/include
 
 # Linking flags
-LDFLAGS =
+LDFLAGS = -lpthread
 
 # C Compiler settings
 CC = cc
 CFLAGS = -g -std=c11 -pedantic -O2 -Wall -Wextra
+# Build stxbulkread without io_uring on Linux
+#CFLAGS += -DLIBSTX_NO_URING
+# Gather statistics for stxstats_snapshot()
+#CFLAGS += -DLIBSTX_STATS
@@ -2,10 +2,20 @@
 #ifndef LIBSTX_H
 #define LIBSTX_H
 
+#include <limits.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+// Storage of the small functions defined at the end of this header, which are
+// inlined into the caller when LIBSTX_INLINE is defined.
+#ifdef LIBSTX_INLINE
+#define LIBSTX_FN static inline
+#else
+#define LIBSTX_FN
+#endif
+
 #ifdef __STDC__
 #if (__STDC_VERSION__ == 201112L)
 #define stxcpy(sp, src) _Generic((src), \
@@ -23,6 +33,9 @@
 		const char *: stxapp_str, \
 		char *: stxapp_str, \
 		uint32_t: stxapp_utf8f32, \
+		uint64_t: stxapp_u64, \
+		int64_t: stxapp_i64, \
+		double: stxapp_f64, \
 		spx: stxapp_spx)(sp, src)
 
 #define stxfind(sp, src) _Generic((src), \
@@ -33,18 +46,24 @@
 #define stxdup(sp, src) _Generic((src), \
 		const char *: stxdup_str, \
 		char *: stxdup_str, \
+		stx *: stxshare, \
 		spx: stxdup_spx)(sp, src)
 #endif
 #endif
 
+struct stxrc;
+
 /**
  * Dynamic and modifiable string data structure. Contents are modifiable and
- * contains both the size of the memory, and how much is being used.
+ * contains both the size of the memory, and how much is being used. Memory
+ * shared by stxshare() is reference counted through "rc", which is NULL when
+ * the stx owns its memory exclusively. A stx set up by hand must set it to NULL.
  */
 struct stx {
 	size_t len;
 	size_t size;
 	char *mem;
+	struct stxrc *rc;
 };
 
 /**
@@ -57,8 +76,158 @@ struct spx {
 	const char *mem;
 };
 
+/**
+ * Read-only memory mapping of a file, created by stxmapfile() and released by
+ * stxunmapfile().
+ */
+struct stxmap {
+	void *addr;
+	size_t len;
+};
+
+/**
+ * Buffered line reader over a file descriptor. Lines are returned as spx
+ * referring to "buf", which is reused for the whole input. "pos" is where the
+ * next line starts and "scan" is how far "buf" was searched for a newline.
+ */
+struct stxreader {
+	struct stx buf;
+	size_t pos;
+	size_t scan;
+	int fd;
+	bool eof;
+};
+
+/**
+ * Read request for stxbulkread(). Bytes read from "fd" at offset "off" are
+ * appended to "buf", and "data" refers to them once the request completes.
+ * "err" is the errno value of a failed request, 0 otherwise.
+ */
+struct stxreadreq {
+	int fd;
+	uint64_t off;
+	struct stx *buf;
+	struct spx data;
+	int err;
+};
+
+// Options of stxbulkread().
+enum {
+	STXREAD_THREADS = 1 << 0,
+};
+
+/**
+ * Options of stxwriteropen(). Zero fields take their default value: "nbufs"
+ * buffers of "size" bytes (2 of 64 KiB), queued for writing once "threshold"
+ * bytes (a full buffer) or "interval" milliseconds (no limit) are reached.
+ */
+struct stxwriteropts {
+	size_t size;
+	size_t nbufs;
+	size_t threshold;
+	unsigned long interval;
+	int sync;
+};
+
+/**
+ * Options of the parallel functions. Zero fields take their default value:
+ * haystacks shorter than "threshold" bytes (1 MiB) are handled by the calling
+ * thread alone, longer ones are split in chunks handled by "threads" threads
+ * (one per online CPU). If "exec" is set, chunks are run by calling it instead,
+ * it must call fn(arg, i) once for each "i" below "n" and return once all
+ * calls returned, "ctx" being passed through.
+ */
+struct stxparopts {
+	size_t threads;
+	size_t threshold;
+	void (*exec)(void *ctx, size_t n, void (*fn)(void *arg, size_t i), void *arg);
+	void *ctx;
+};
+
+/**
+ * Key and value of a query string pair, referring to the query. "enc" is set
+ * if either has escapes, and needs stxapp_urldec() with STXURL_PLUS.
+ */
+struct stxkv {
+	struct spx key;
+	struct spx val;
+	bool enc;
+};
+
+// Options of stxapp_urlenc() and stxapp_urldec().
+enum {
+	STXURL_PLUS = 1 << 0,
+};
+
+// When an stxwriter calls fdatasync().
+enum {
+	STXSYNC_NONE,
+	STXSYNC_FLUSH,
+	STXSYNC_EACH,
+};
+
+// Access pattern hints for stxmapfile().
+enum {
+	STXMAP_SEQUENTIAL = 1 << 0,
+	STXMAP_WILLNEED = 1 << 1,
+	STXMAP_HUGEPAGE = 1 << 2,
+};
+
+// Instruction set levels of the kernels picked by libstx, see stxcpu().
+enum {
+	STXCPU_SCALAR,
+	STXCPU_SSE2,
+	STXCPU_SSE42,
+	STXCPU_AVX2,
+	STXCPU_AVX512,
+};
+
+// Functions counted by stxstats_snapshot().
+enum {
+	STXSTATS_ALLOC,
+	STXSTATS_GROW,
+	STXSTATS_ENSURESIZE,
+	STXSTATS_UNSHARE,
+	STXSTATS_INS,
+	STXSTATS_INSV,
+	STXSTATS_LSTRIP,
+	STXSTATS_REPLACE,
+	STXSTATS_FUNCS,
+};
+
+/**
+ * Allocation and data movement statistics, gathered when libstx is built with
+ * LIBSTX_STATS defined. "growth" counts how many times a stx grew by between
+ * 2^i and 2^(i+1)-1 bytes.
+ */
+struct stxstats {
+	uint64_t calls[STXSTATS_FUNCS];
+	uint64_t allocs;
+	uint64_t alloc_bytes;
+	uint64_t reallocs;
+	uint64_t realloc_bytes;
+	uint64_t moves;
+	uint64_t move_bytes;
+	uint64_t growth[64];
+};
+
 typedef struct stx stx;
 typedef struct spx spx;
+typedef struct stxglob stxglob;
+typedef struct stxkv stxkv;
+typedef struct stxmap stxmap;
+typedef struct stxparopts stxparopts;
+typedef struct stxre stxre;
+typedef struct stxreader stxreader;
+typedef struct stxreadreq stxreadreq;
+typedef struct stxwriter stxwriter;
+typedef struct stxwriteropts stxwriteropts;
+
+// Format a spx with the printf family, e.g. stxappf(sp, "<" STXFMT ">", STXARG(s)).
+// The precision is an int, so only the first INT_MAX bytes of a spx are used.
+// stxappf() and stxcpyf() also take a whole spx, null bytes included, with "%v".
+#define STXFMT "%.*s"
+#define STXARG(sp) ((sp).len > INT_MAX ? INT_MAX : (int)(sp).len), (sp).mem
 
 // Initialize and allocate a new stx.
 int stxalloc(stx *sp, size_t n);
@@ -72,31 +241,44 @@ int stxgrow(stx *sp, size_t n);
 int stxensuresize(stx *sp, size_t n);
 // Validate a stx in the case where some of it's internal data might have been
 // changed incorrectly.
-bool stxvalid(stx *sp);
+LIBSTX_FN bool stxvalid(stx *sp);
 
 // Get the amount of unused space left in a stx.
-size_t stxavail(stx *sp);
+LIBSTX_FN size_t stxavail(stx *sp);
 
 // Compare two slices for equality, stx's can be compared by turning them into
 // references first.
 bool stxcmp(spx s1, spx s2);
+// Compare two slices ignoring the case of ASCII letters, for equality or for
+// their order.
+bool stxicmp(const spx s1, const spx s2);
+int stxicmp3(const spx s1, const spx s2);
 
-void stxswap(stx *s1, stx *s2);
-stx *stxtrunc(stx *sp, size_t n);
-stx *stxterm(stx *sp);
+LIBSTX_FN void stxswap(stx *s1, stx *s2);
+LIBSTX_FN stx *stxtrunc(stx *sp, size_t n);
+LIBSTX_FN stx *stxterm(stx *sp);
 
 // Create a spx reference from a stx.
-spx stxref(const stx *sp);
+LIBSTX_FN spx stxref(const stx *sp);
 
 // Allocte a stx and copy the context of "src" into it.
 int stxdup_mem(stx *sp, const void *src, size_t n);
 int stxdup_str(stx *sp, const char *src);
 int stxdup_spx(stx *sp, const spx src);
 
+// Share the memory of "src" with "sp" without copying it. The memory is copied
+// on the first write through either stx.
+int stxshare(stx *sp, stx *src);
+// Give a stx exclusive ownership of its memory, copying it if it is shared.
+int stxunshare(stx *sp);
+
 // Copy bytes from "src" into a stx.
 stx *stxcpy_mem(stx *sp, const void *src, size_t n);
 stx *stxcpy_str(stx *sp, const char *src);
 stx *stxcpy_spx(stx *sp, const spx src);
+// Copy printf formatted output into a stx, growing it if needed.
+int stxcpyf(stx *sp, const char *fmt, ...);
+int stxvcpyf(stx *sp, const char *fmt, va_list ap);
 
 // Insert bytes into the middle of stx without overwriting any data.
 stx *stxins_mem(stx *sp, size_t pos, const void *src, size_t n);
@@ -109,28 +291,217 @@ stx *stxapp_mem(stx *sp, const void *src, size_t n);
 stx *stxapp_str(stx *sp, const char *src);
 stx *stxapp_utf8f32(stx *sp, uint32_t wc);
 stx *stxapp_spx(stx *sp, const spx src);
+// Append printf formatted output to a stx, growing it if needed.
+int stxappf(stx *sp, const char *fmt, ...);
+int stxvappf(stx *sp, const char *fmt, va_list ap);
+// Append the decimal, hexadecimal or shortest round-trip text of a number.
+stx *stxapp_u64(stx *sp, uint64_t v);
+stx *stxapp_i64(stx *sp, int64_t v);
+stx *stxapp_hex(stx *sp, uint64_t v);
+stx *stxapp_f64(stx *sp, double d);
+
+// Append a spx escaped as the contents of a JSON string, or the contents of a
+// JSON string unescaped, growing the stx once if needed.
+int stxapp_jsonesc(stx *sp, const spx src);
+int stxapp_jsonunesc(stx *sp, const spx src);
+
+// Append a spx percent-encoded for URLs, or percent-decoded, growing the stx
+// once if needed. STXURL_PLUS encodes spaces as '+' and decodes '+' as spaces.
+int stxapp_urlenc(stx *sp, const spx src, int flags);
+int stxapp_urldec(stx *sp, const spx src, int flags);
+// Split a query string in up to "n" pairs, without decoding them.
+size_t stxquery(const spx query, stxkv *kvs, size_t n);
+
+// Append "n" spx separated by "sep", growing the stx once if needed.
+int stxjoin(stx *sp, const spx *parts, size_t n, const spx sep);
+
+// Append or insert a list of segments, growing the stx once if needed.
+int stxappv(stx *sp, const spx *segs, size_t n);
+int stxinsv(stx *sp, size_t pos, const spx *segs, size_t n);
+// Same as stxappv() for the buffers of readv(), see <sys/uio.h>.
+struct iovec;
+int stxappiov(stx *sp, const struct iovec *iov, int cnt);
 
 // Find a substring inside a stx and return it as a spx referring to it.
 spx stxfind_mem(const spx haystack, const void *needle, size_t n);
 spx stxfind_str(const spx haystack, const char *needle);
 spx stxfind_spx(const spx haystack, const spx needle);
+// Find a substring ignoring the case of ASCII letters.
+spx stxifind_mem(const spx haystack, const void *needle, size_t n);
+spx stxifind_str(const spx haystack, const char *needle);
+spx stxifind_spx(const spx haystack, const spx needle);
+
+// Find the first occurrence, or count every occurrence, overlapping ones
+// included, of a substring with several threads.
+spx stxfind_par(const spx haystack, const spx needle, const stxparopts *opts);
+size_t stxcount_par(const spx haystack, const spx needle, const stxparopts *opts);
+// Count utf8 encodings, validate or hash with several threads, with the same
+// result as stxutf8len(), stxutf8valid() and stxhash().
+size_t stxutf8len_par(const spx sp, const stxparopts *opts);
+bool stxutf8valid_par(const spx sp, const stxparopts *opts);
+uint64_t stxhash_par(const spx sp, const stxparopts *opts);
+
+// Hash the bytes of a spx. The hash isn't cryptographic, but is the same on
+// every host and in stxhash_par().
+uint64_t stxhash(const spx sp);
+
+// Compile a shell wildcard pattern of '*', '?' and "[...]", and match whole
+// spx against it.
+int stxglobcomp(stxglob **gp, const spx pattern);
+bool stxglobmatch(const stxglob *g, const spx sp);
+void stxglobfree(stxglob *g);
+
+// Compile a regular expression, and find its leftmost match in linear time.
+// "match" receives the match and then up to "nsub" - 1 groups.
+int stxrecomp(stxre **rep, const spx pattern);
+int stxrefind(stxre *re, const spx text, spx *match, size_t nsub);
+size_t stxregroups(const stxre *re);
+void stxrefree(stxre *re);
+
+// Replace up to "max" occurrences of "from" in a stx by "to".
+int stxreplace(stx *sp, const spx from, const spx to, size_t max);
+
+// Map a file read-only and refer to its contents with a spx, without copying.
+int stxmapfile(const char *path, spx *out, stxmap *mp, int hints);
+int stxunmapfile(stxmap *mp);
+
+// Read the next line from a file descriptor, without its newline.
+int stxgetline(stxreader *rd, spx *line);
+// Fill the unused space of many stx from file descriptors concurrently.
+int stxbulkread(stxreadreq *reqs, size_t n, int flags);
+
+// Write to a file descriptor from a background thread. Bytes are appended to
+// the stx returned by stxwriterget(), which is handed back by stxwriterput().
+// The writer stays locked in between, see stxwriter(3).
+int stxwriteropen(stxwriter **wp, int fd, const stxwriteropts *opts);
+stx *stxwriterget(stxwriter *w, size_t n);
+void stxwriterput(stxwriter *w);
+int stxwriterflush(stxwriter *w);
+int stxwriterclose(stxwriter *w);
+
+// Write all "n" spx to a file descriptor with as few system calls as possible.
+int stxwritev(int fd, const spx *parts, size_t n);
+
+// Instruction set level of the kernels in use.
+int stxcpu(void);
+
+// Sum the statistics of every thread so far.
+int stxstats_snapshot(struct stxstats *st);
 
 // Slice a substring inside a spx and return it as a spx referring to it.
-spx stxslice(const spx sp, size_t begin, size_t end);
+LIBSTX_FN spx stxslice(const spx sp, size_t begin, size_t end);
 
 // Strip characters from a stx.
 stx *stxrstrip(stx *sp, const char *chs, size_t n);
 stx *stxlstrip(stx *sp, const char *chs, size_t n);
 stx *stxstrip(stx *sp, const char *chs, size_t n);
 
+// Convert the ASCII letters of a stx to lower or upper case, other bytes are
+// left as they are.
+stx *stxtolower(stx *sp);
+stx *stxtoupper(stx *sp);
+stx *stxtolower_spx(stx *dst, const spx src);
+stx *stxtoupper_spx(stx *dst, const spx src);
+
 // Tokenize a spx.
 spx stxtok(spx *sp, const char *chs, size_t n);
 
+// Parse a number at the start of a spx, returning the number of bytes used.
+size_t stxtou64(const spx sp, uint64_t *n);
+size_t stxtoi64(const spx sp, int64_t *n);
+size_t stxtod(const spx sp, double *d);
+
 // Calculate the number of utf8 encodings in a spx.
 size_t stxutf8len(const spx sp);
+// Check that a spx is made of valid utf8 encodings only.
+bool stxutf8valid(const spx sp);
 // Calculate the number of bytes for a utf8 encoding of a utf32 code point.
 size_t stxutf8n32(uint32_t wc);
 // Convert a "wc" into a utf8 encoding "n" bytes long and store it in "dst".
 size_t stxutf8f32(void *dst, uint32_t wc, size_t n);
 
+/**
+ * Definitions of the small functions. The library compiles each of them in its
+ * own object by defining LIBSTX_DEFINE_<NAME>, and LIBSTX_INLINE makes all of
+ * them static inline in the including file instead, so both always agree.
+ */
+#if defined(LIBSTX_INLINE) || defined(LIBSTX_DEFINE_STXVALID)
+LIBSTX_FN bool
+stxvalid(stx *sp)
+{
+	if (!sp)
+		return false;
+	if (!sp->mem || sp->size < sp->len)
+		return false;
+
+	return true;
+}
+#endif
+
+#if defined(LIBSTX_INLINE) || defined(LIBSTX_DEFINE_STXAVAIL)
+LIBSTX_FN size_t
+stxavail(stx *sp)
+{
+	return sp->size - sp->len;
+}
+#endif
+
+#if defined(LIBSTX_INLINE) || defined(LIBSTX_DEFINE_STXSWAP)
+LIBSTX_FN void
+stxswap(stx *s1, stx *s2)
+{
+	stx tmp = *s1;
+	*s1 = *s2;
+	*s2 = tmp;
+}
+#endif
+
+#if defined(LIBSTX_INLINE) || defined(LIBSTX_DEFINE_STXTRUNC)
+LIBSTX_FN stx *
+stxtrunc(stx *sp, size_t len)
+{
+	if (len >= sp->len) {
+		sp->len = 0;
+		return sp;
+	}
+
+	sp->len -= len;
+	return sp;
+}
+#endif
+
+#if defined(LIBSTX_INLINE) || defined(LIBSTX_DEFINE_STXTERM)
+LIBSTX_FN stx *
+stxterm(stx *sp)
+{
+	// Shared memory is copied before writing to it.
+	if (sp->len < sp->size && (!sp->rc || !stxunshare(sp)))
+		sp->mem[sp->len] = '\0';
+
+	return sp;
+}
+#endif
+
+#if defined(LIBSTX_INLINE) || defined(LIBSTX_DEFINE_STXREF)
+LIBSTX_FN spx
+stxref(const stx *sp)
+{
+	spx tmp = {.mem = sp->mem, .len = sp->len};
+	return tmp;
+}
+#endif
+
+#if defined(LIBSTX_INLINE) || defined(LIBSTX_DEFINE_STXSLICE)
+LIBSTX_FN spx
+stxslice(const spx src, size_t begin, size_t end)
+{
+	spx slice = {
+		.mem = src.mem + begin,
+		.len = end - begin
+	};
+
+	return slice;
+}
+#endif
+
 #endif
@@ -3,9 +3,15 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
 #include "../libstx.h"
 
+// Reference count of memory shared between several stx.
+struct stxrc {
+	atomic_size_t refs;
+};
+
 static inline bool
 internal_size_add_overflows(size_t a, size_t b)
 {
@@ -18,6 +24,169 @@ internal_min(size_t a, size_t b)
 	return a > b ? b : a;
 }
 
+// Number of decimal digits of "v".
+static inline size_t
+internal_u64len(uint64_t v)
+{
+	size_t n = 1;
+
+	for (;;) {
+		if (v < 10)
+			return n;
+		if (v < 100)
+			return n + 1;
+		if (v < 1000)
+			return n + 2;
+		if (v < 10000)
+			return n + 3;
+
+		v /= 10000;
+		n += 4;
+	}
+}
+
+// Multiply "a" and "b", returning the lower half of the 128 bit product and
+// storing the upper half in "hi".
+static inline uint64_t
+internal_mul128(uint64_t a, uint64_t b, uint64_t *hi)
+{
+#ifdef __SIZEOF_INT128__
+	__extension__ unsigned __int128 r = (unsigned __int128)a * b;
+
+	*hi = r >> 64;
+	return r;
+#else
+	uint64_t ll = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+	uint64_t lh = (a & 0xFFFFFFFF) * (b >> 32);
+	uint64_t hl = (a >> 32) * (b & 0xFFFFFFFF);
+	uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+
+	*hi = (a >> 32) * (b >> 32) + (lh >> 32) + (hl >> 32) + (mid >> 32);
+	return (mid << 32) | (ll & 0xFFFFFFFF);
+#endif
+}
+
+// Floor of x / 2^n, which >> on a negative number isn't guaranteed to be.
+static inline int64_t
+internal_floorshr(int64_t x, int n)
+{
+	return x >= 0 ? x >> n : -((-x + ((int64_t)1 << n) - 1) >> n);
+}
+
+// Number of leading zero bits in a non-zero "x".
+static inline int
+internal_clz64(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_clzll(x);
+#else
+	int n = 0;
+
+	while (!(x & (UINT64_C(1) << 63))) {
+		x <<= 1;
+		++n;
+	}
+
+	return n;
+#endif
+}
+
+// Number of trailing zero bits in a non-zero "x".
+static inline int
+internal_ctz64(uint64_t x)
+{
+#ifdef __GNUC__
+	return __builtin_ctzll(x);
+#else
+	int n = 0;
+
+	while (!(x & 1)) {
+		x >>= 1;
+		++n;
+	}
+
+	return n;
+#endif
+}
+
+// Number of bits set in "x".
+static inline int
+internal_popcount64(uint64_t x)
+{
+#ifdef __GNUC__
+	return __builtin_popcountll(x);
+#else
+	x -= (x >> 1) & UINT64_C(0x5555555555555555);
+	x = (x & UINT64_C(0x3333333333333333)) + ((x >> 2) & UINT64_C(0x3333333333333333));
+	x = (x + (x >> 4)) & UINT64_C(0x0F0F0F0F0F0F0F0F);
+
+	return (x * UINT64_C(0x0101010101010101)) >> 56;
+#endif
+}
+
+// Load 8 bytes as a little-endian word, whatever the byte order of the host.
+static inline uint64_t
+internal_load64le(const void *src)
+{
+	const unsigned char *p = src;
+
+	return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16 |
+	    (uint64_t)p[3] << 24 | (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 |
+	    (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+// Set the high bit of each byte of "x" between "lo" and "hi", both ASCII. Bytes
+// are handled as 7 bit values so additions never carry into the next byte.
+static inline uint64_t
+internal_swar_inrange(uint64_t x, unsigned char lo, unsigned char hi)
+{
+	const uint64_t ones = UINT64_C(0x0101010101010101);
+	uint64_t low7 = x & ones * 0x7f;
+	uint64_t ge = low7 + ones * (0x80 - lo);
+	uint64_t gt = low7 + ones * (0x7f - hi);
+
+	return (ge ^ gt) & ~x & ones * 0x80;
+}
+
+// Lower case the ASCII letters of a byte, or of each byte of a word.
+static inline unsigned char
+internal_tolower(unsigned char c)
+{
+	return (unsigned char)(c - 'A') < 26 ? c | 0x20 : c;
+}
+
+static inline uint64_t
+internal_swar_tolower(uint64_t x)
+{
+	return x | internal_swar_inrange(x, 'A', 'Z') >> 2;
+}
+
+/**
+ * Kernels with a version for each instruction set level, the table of the best
+ * level the CPU supports is picked once at startup by stxcpu.c.
+ */
+struct internal_kernels {
+	// Number of bytes that aren't utf8 continuation bytes.
+	size_t (*utf8len)(const char *mem, size_t n);
+	// Flip the case bit of the ASCII letters between "lo" and "lo" + 25.
+	void (*flipcase)(char *dst, const char *src, size_t n, unsigned char lo);
+	// Index of the first byte differing ignoring ASCII case, or "n".
+	size_t (*imismatch)(const char *s1, const char *s2, size_t n);
+	// Index of the first byte lower casing to the lower case "c", or "n".
+	size_t (*ichr)(const char *mem, size_t n, unsigned char c);
+	// Length of the longest prefix, or suffix, made of bytes of "set".
+	size_t (*span)(const char *mem, size_t n, const char *set, size_t len);
+	size_t (*rspan)(const char *mem, size_t n, const char *set, size_t len);
+	// Index of the first control byte, '"' or '\\', which JSON escapes, or "n".
+	size_t (*jsonesc)(const char *mem, size_t n);
+	// Index of the first byte that isn't unreserved in URLs, or "n".
+	size_t (*urlenc)(const char *mem, size_t n);
+	// Index of the first byte equal to "c1" or "c2", or "n".
+	size_t (*chr2)(const char *mem, size_t n, unsigned char c1, unsigned char c2);
+};
+
+extern const struct internal_kernels *internal_kern;
+
 static inline size_t
 internal_strncpy(char *str, const char *src, size_t max)
 {
@@ -30,3 +199,36 @@ internal_strncpy(char *str, const char *src, size_t max)
 
 	return i;
 }
+
+// Run fn(arg, i) for each "i" below "n", on the threads or executor of "opts".
+// Chunks are started in increasing order by the threads of libstx.
+void internal_par(const stxparopts *opts, size_t n, void (*fn)(void *, size_t), void *arg);
+// Number of threads used with "opts".
+size_t internal_par_threads(const stxparopts *opts);
+
+// Hashes are sums of the hashes of blocks of this size, so any split of the
+// input on block boundaries hashes the same.
+#define INTERNAL_HASH_BLOCK 65536
+uint64_t internal_hash_blocks(const char *mem, size_t n, uint64_t index);
+uint64_t internal_hash_final(uint64_t sum, size_t n);
+
+// Statistics hooks, which compile to nothing unless LIBSTX_STATS is defined.
+#ifdef LIBSTX_STATS
+void internal_stats_call(int fn);
+void internal_stats_alloc(size_t n);
+void internal_stats_realloc(size_t size, size_t growth);
+void internal_stats_move(size_t n);
+#else
+static inline void internal_stats_call(int fn) { (void)fn; }
+static inline void internal_stats_alloc(size_t n) { (void)n; }
+static inline void
+internal_stats_realloc(size_t size, size_t growth) { (void)size; (void)growth; }
+static inline void internal_stats_move(size_t n) { (void)n; }
+#endif
+
+// Make sure a stx can be written to, copying its memory if it is shared.
+static inline int
+internal_own(stx *sp)
+{
+	return sp->rc ? stxunshare(sp) : 0;
+}
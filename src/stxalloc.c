@@ -4,7 +4,10 @@
 int
 stxalloc(stx *sp, size_t n)
 {
+	internal_stats_call(STXSTATS_ALLOC);
+
 	sp->len = 0;
+	sp->rc = NULL;
 
 	// Always set the memory location to NULL, don't let the implementation
 	// of malloc decide what to do.
@@ -17,6 +20,8 @@ stxalloc(stx *sp, size_t n)
 	if (!(sp->mem = malloc(n)))
 		return -1;
 
+	internal_stats_alloc(n);
+
 	sp->size = n;
 
 	return 0;
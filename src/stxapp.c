@@ -1,10 +1,19 @@
 // See LICENSE file for copyright and license details
-#include "internal.h"
+#include <errno.h>
+#include <limits.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <wchar.h>
+
+#include "internal.h"
 
 stx *
 stxapp_mem(stx *sp, const void *src, size_t n)
 {
+	if (internal_own(sp))
+		return sp;
+
 	n = internal_min(sp->size, n);
 
 	memmove(sp->mem + sp->len, src, n);
@@ -16,6 +25,9 @@ stxapp_mem(stx *sp, const void *src, size_t n)
 stx *
 stxapp_str(stx *sp, const char *src)
 {
+	if (internal_own(sp))
+		return sp;
+
 	sp->len += internal_strncpy(sp->mem + sp->len, src, sp->size - sp->len);
 	return sp;
 }
@@ -39,3 +51,641 @@ stxapp_spx(stx *s1, const spx s2)
 {
 	return stxapp_mem(s1, s2.mem, s2.len);
 }
+
+// Length modifiers of a conversion.
+enum {
+	LEN_NONE,
+	LEN_HH,
+	LEN_H,
+	LEN_L,
+	LEN_LL,
+	LEN_J,
+	LEN_Z,
+	LEN_T,
+	LEN_BIGL,
+};
+
+// A conversion specification, e.g. "%-8.3lx".
+struct conv {
+	bool left, plus, space, alt, zero, group;
+	int width;
+	int prec;              // -1 without a precision.
+	int len;
+	char c;
+};
+
+// Arguments in a struct, so helpers can take them from a pointer.
+struct args {
+	va_list ap;
+	size_t start;          // Length of the stx before the call, for "%n".
+	uintptr_t mem;         // Memory of the stx before the call, and its size.
+	size_t size;
+};
+
+// An argument formatted by snprintf().
+union arg {
+	intmax_t i;
+	uintmax_t u;
+	double d;
+	long double ld;
+	void *p;
+	wint_t wc;
+	const wchar_t *ws;
+};
+
+// Make room for "n" bytes and a null-terminator after the length of "sp",
+// growing it at most once and by at least its size. "*src", when pointing into
+// the memory of "sp", is moved along with it.
+static int
+reserve(stx *sp, size_t n, const char **src)
+{
+	size_t avail = sp->size - sp->len;
+	size_t off = 0;
+	bool inside = false;
+
+	if (n < avail)
+		return 0;
+
+	if (internal_size_add_overflows(n, 1)) {
+		errno = EOVERFLOW;
+		return -1;
+	}
+
+	if (src && sp->mem) {
+		uintptr_t p = (uintptr_t)*src, mem = (uintptr_t)sp->mem;
+
+		if (p >= mem && p - mem < sp->size) {
+			inside = true;
+			off = p - mem;
+		}
+	}
+
+	n = n + 1 - avail;
+	if (stxgrow(sp, n > sp->size ? n : sp->size))
+		return -1;
+
+	if (inside)
+		*src = sp->mem + off;
+
+	return 0;
+}
+
+static void
+fill(stx *sp, char c, size_t n)
+{
+	memset(sp->mem + sp->len, c, n);
+	sp->len += n;
+}
+
+static const char *
+number(const char *fmt, int *n)
+{
+	for (*n = 0; '0' <= *fmt && '9' >= *fmt; ++fmt) {
+		if (*n > (INT_MAX - (*fmt - '0')) / 10) {
+			errno = EOVERFLOW;
+			return NULL;
+		}
+
+		*n = *n * 10 + (*fmt - '0');
+	}
+
+	return fmt;
+}
+
+// Parse the conversion after a '%', taking '*' widths and precisions from "a".
+static const char *
+parse(const char *fmt, struct conv *cv, struct args *a)
+{
+	memset(cv, 0, sizeof(*cv));
+	cv->prec = -1;
+
+	for (;; ++fmt) {
+		if ('-' == *fmt)
+			cv->left = true;
+		else if ('+' == *fmt)
+			cv->plus = true;
+		else if (' ' == *fmt)
+			cv->space = true;
+		else if ('#' == *fmt)
+			cv->alt = true;
+		else if ('0' == *fmt)
+			cv->zero = true;
+		else if ('\'' == *fmt)
+			cv->group = true;
+		else
+			break;
+	}
+
+	if ('*' == *fmt) {
+		// A negative width is a '-' flag and a positive width.
+		if (0 > (cv->width = va_arg(a->ap, int))) {
+			if (INT_MIN == cv->width) {
+				errno = EOVERFLOW;
+				return NULL;
+			}
+
+			cv->left = true;
+			cv->width = -cv->width;
+		}
+
+		++fmt;
+	} else if (!(fmt = number(fmt, &cv->width))) {
+		return NULL;
+	}
+
+	if ('.' == *fmt) {
+		if ('*' == *++fmt) {
+			// A negative precision is no precision.
+			if (0 > (cv->prec = va_arg(a->ap, int)))
+				cv->prec = -1;
+
+			++fmt;
+		} else if (!(fmt = number(fmt, &cv->prec))) {
+			return NULL;
+		}
+	}
+
+	switch (*fmt) {
+	case 'h':
+		if ('h' == *++fmt) {
+			cv->len = LEN_HH;
+			++fmt;
+		} else {
+			cv->len = LEN_H;
+		}
+		break;
+	case 'l':
+		if ('l' == *++fmt) {
+			cv->len = LEN_LL;
+			++fmt;
+		} else {
+			cv->len = LEN_L;
+		}
+		break;
+	case 'j':
+		cv->len = LEN_J;
+		++fmt;
+		break;
+	case 'z':
+		cv->len = LEN_Z;
+		++fmt;
+		break;
+	case 't':
+		cv->len = LEN_T;
+		++fmt;
+		break;
+	case 'L':
+		cv->len = LEN_BIGL;
+		++fmt;
+		break;
+	}
+
+	if (!(cv->c = *fmt)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	return fmt + 1;
+}
+
+static int64_t
+signedarg(int len, struct args *a)
+{
+	switch (len) {
+	case LEN_HH:
+		return (signed char)va_arg(a->ap, int);
+	case LEN_H:
+		return (short)va_arg(a->ap, int);
+	case LEN_L:
+		return va_arg(a->ap, long);
+	case LEN_LL:
+	case LEN_BIGL:
+		return va_arg(a->ap, long long);
+	case LEN_J:
+		return va_arg(a->ap, intmax_t);
+	case LEN_Z:
+		return (ptrdiff_t)va_arg(a->ap, size_t);
+	case LEN_T:
+		return va_arg(a->ap, ptrdiff_t);
+	default:
+		return va_arg(a->ap, int);
+	}
+}
+
+static uint64_t
+unsignedarg(int len, struct args *a)
+{
+	switch (len) {
+	case LEN_HH:
+		return (unsigned char)va_arg(a->ap, int);
+	case LEN_H:
+		return (unsigned short)va_arg(a->ap, int);
+	case LEN_L:
+		return va_arg(a->ap, unsigned long);
+	case LEN_LL:
+	case LEN_BIGL:
+		return va_arg(a->ap, unsigned long long);
+	case LEN_J:
+		return va_arg(a->ap, uintmax_t);
+	case LEN_Z:
+		return va_arg(a->ap, size_t);
+	case LEN_T:
+		return (size_t)va_arg(a->ap, ptrdiff_t);
+	default:
+		return va_arg(a->ap, unsigned);
+	}
+}
+
+// Arguments pointing into the memory "sp" had before the call follow it when
+// an earlier piece grew it.
+static const char *
+rebase(const stx *sp, const struct args *a, const char *src)
+{
+	uintptr_t p = (uintptr_t)src;
+
+	if (a->mem && p >= a->mem && p - a->mem < a->size)
+		return sp->mem + (p - a->mem);
+
+	return src;
+}
+
+// Append "n" bytes of "src", padded to the width.
+static int
+fmtmem(stx *sp, const struct conv *cv, const char *src, size_t n)
+{
+	size_t pad = (size_t)cv->width > n ? cv->width - n : 0;
+
+	if (reserve(sp, n + pad, &src))
+		return -1;
+
+	if (!cv->left)
+		fill(sp, ' ', pad);
+
+	memmove(sp->mem + sp->len, src, n);
+	sp->len += n;
+
+	if (cv->left)
+		fill(sp, ' ', pad);
+
+	return 0;
+}
+
+// Append an integer from its sign, or 0, and magnitude. All of it is measured
+// first, then the digits are written in place by stxapp_u64() and friends.
+static int
+fmtint(stx *sp, const struct conv *cv, char sign, uint64_t v)
+{
+	static const char xdigits[16] = "0123456789ABCDEF";
+	int shift = 'o' == cv->c ? 3 : 4;
+	size_t nd, np = 0, nz = 0, n, w = cv->width;
+	char prefix[2];
+
+	if (!v && !cv->prec)
+		nd = 0;
+	else if ('d' == cv->c || 'i' == cv->c || 'u' == cv->c)
+		nd = internal_u64len(v);
+	else if (!v)
+		nd = 1;
+	else
+		nd = (64 - internal_clz64(v) + shift - 1) / shift;
+
+	if (sign)
+		prefix[np++] = sign;
+	if (cv->alt && v && ('x' == cv->c || 'X' == cv->c)) {
+		prefix[np++] = '0';
+		prefix[np++] = cv->c;
+	}
+
+	if (0 < cv->prec && (size_t)cv->prec > nd)
+		nz = cv->prec - nd;
+	// The alternative octal form starts with a 0.
+	if (cv->alt && 'o' == cv->c && !nz && (v || !nd))
+		nz = 1;
+
+	n = np + nz + nd;
+	if (cv->zero && !cv->left && 0 > cv->prec && w > n) {
+		nz += w - n;
+		n = w;
+	}
+
+	if (reserve(sp, w > n ? w : n, NULL))
+		return -1;
+
+	if (!cv->left && w > n)
+		fill(sp, ' ', w - n);
+
+	memcpy(sp->mem + sp->len, prefix, np);
+	sp->len += np;
+	fill(sp, '0', nz);
+
+	if (!nd) {
+		// Nothing but padding.
+	} else if ('x' == cv->c) {
+		stxapp_hex(sp, v);
+	} else if ('X' == cv->c || 'o' == cv->c) {
+		char *end = sp->mem + sp->len + nd;
+
+		do {
+			*--end = xdigits[v & ((1u << shift) - 1)];
+			v >>= shift;
+		} while (v);
+
+		sp->len += nd;
+	} else {
+		stxapp_u64(sp, v);
+	}
+
+	if (cv->left && w > n)
+		fill(sp, ' ', w - n);
+
+	return 0;
+}
+
+static int
+libcfmt(char *dst, size_t n, const char *spec, const struct conv *cv, const union arg *a)
+{
+	switch (cv->c) {
+	case 'd':
+	case 'i':
+		return snprintf(dst, n, spec, cv->width, cv->prec, a->i);
+	case 'u':
+	case 'o':
+	case 'x':
+	case 'X':
+		return snprintf(dst, n, spec, cv->width, cv->prec, a->u);
+	case 'c':
+		return snprintf(dst, n, spec, cv->width, cv->prec, a->wc);
+	case 's':
+		return snprintf(dst, n, spec, cv->width, cv->prec, a->ws);
+	case 'p':
+		return snprintf(dst, n, spec, cv->width, cv->prec, a->p);
+	default:
+		if (LEN_BIGL == cv->len)
+			return snprintf(dst, n, spec, cv->width, cv->prec, a->ld);
+		return snprintf(dst, n, spec, cv->width, cv->prec, a->d);
+	}
+}
+
+// Append a conversion libstx leaves to snprintf(): floating point numbers,
+// pointers, wide characters and grouped integers. It's formatted in place when
+// it fits, else measured and formatted again after growing once.
+static int
+fmtlibc(stx *sp, const struct conv *cv, const union arg *a)
+{
+	char spec[16], *p = spec;
+	size_t avail = sp->size - sp->len;
+	int n;
+
+	*p++ = '%';
+	if (cv->left)
+		*p++ = '-';
+	if (cv->plus)
+		*p++ = '+';
+	if (cv->space)
+		*p++ = ' ';
+	if (cv->alt)
+		*p++ = '#';
+	if (cv->zero)
+		*p++ = '0';
+	if (cv->group)
+		*p++ = '\'';
+	*p++ = '*';
+	*p++ = '.';
+	*p++ = '*';
+
+	if (strchr("diuoxX", cv->c))
+		*p++ = 'j';
+	else if ('c' == cv->c || 's' == cv->c)
+		*p++ = 'l';
+	else if (LEN_BIGL == cv->len)
+		*p++ = 'L';
+	*p++ = cv->c;
+	*p = '\0';
+
+	if (0 > (n = libcfmt(avail ? sp->mem + sp->len : NULL, avail, spec, cv, a)))
+		return -1;
+
+	if ((size_t)n >= avail) {
+		if (reserve(sp, n, NULL))
+			return -1;
+
+		libcfmt(sp->mem + sp->len, (size_t)n + 1, spec, cv, a);
+	}
+
+	sp->len += n;
+
+	return 0;
+}
+
+// Store the number of bytes output so far for "%n".
+static void
+fmtcount(int len, size_t n, struct args *a)
+{
+	switch (len) {
+	case LEN_HH:
+		*va_arg(a->ap, signed char *) = n;
+		break;
+	case LEN_H:
+		*va_arg(a->ap, short *) = n;
+		break;
+	case LEN_L:
+		*va_arg(a->ap, long *) = n;
+		break;
+	case LEN_LL:
+		*va_arg(a->ap, long long *) = n;
+		break;
+	case LEN_J:
+		*va_arg(a->ap, intmax_t *) = n;
+		break;
+	case LEN_Z:
+		*va_arg(a->ap, size_t *) = n;
+		break;
+	case LEN_T:
+		*va_arg(a->ap, ptrdiff_t *) = n;
+		break;
+	default:
+		*va_arg(a->ap, int *) = n;
+		break;
+	}
+}
+
+// Append each literal run and conversion of "fmt" straight into the unused
+// memory, growing "sp" at most once per piece that doesn't fit.
+static int
+format(stx *sp, const char *fmt, struct args *a)
+{
+	struct conv cv;
+	union arg arg;
+
+	for (;;) {
+		const char *pct = strchr(fmt, '%');
+		size_t n = pct ? (size_t)(pct - fmt) : strlen(fmt);
+
+		if (n) {
+			if (reserve(sp, n, NULL))
+				return -1;
+
+			memcpy(sp->mem + sp->len, fmt, n);
+			sp->len += n;
+		}
+
+		if (!pct)
+			return 0;
+
+		if (!(fmt = parse(pct + 1, &cv, a)))
+			return -1;
+
+		switch (cv.c) {
+		case '%':
+			if (reserve(sp, 1, NULL))
+				return -1;
+
+			sp->mem[sp->len++] = '%';
+			break;
+		case 'd':
+		case 'i': {
+			int64_t v = signedarg(cv.len, a);
+			uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+			char sign = v < 0 ? '-' : cv.plus ? '+' : cv.space ? ' ' : 0;
+
+			if (cv.group) {
+				arg.i = v;
+				if (fmtlibc(sp, &cv, &arg))
+					return -1;
+			} else if (fmtint(sp, &cv, sign, u)) {
+				return -1;
+			}
+
+			break;
+		}
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			if (cv.group) {
+				arg.u = unsignedarg(cv.len, a);
+				if (fmtlibc(sp, &cv, &arg))
+					return -1;
+			} else if (fmtint(sp, &cv, 0, unsignedarg(cv.len, a))) {
+				return -1;
+			}
+
+			break;
+		case 'c':
+			if (LEN_L == cv.len) {
+				arg.wc = va_arg(a->ap, wint_t);
+				if (fmtlibc(sp, &cv, &arg))
+					return -1;
+			} else {
+				char c = (unsigned char)va_arg(a->ap, int);
+
+				if (fmtmem(sp, &cv, &c, 1))
+					return -1;
+			}
+
+			break;
+		case 's':
+			if (LEN_L == cv.len) {
+				arg.ws = va_arg(a->ap, const wchar_t *);
+				if (fmtlibc(sp, &cv, &arg))
+					return -1;
+			} else {
+				const char *s = rebase(sp, a, va_arg(a->ap, const char *));
+				const char *nul;
+
+				if (!s)
+					s = "(null)";
+
+				// STXFMT: the precision bounds the bytes read.
+				if (0 <= cv.prec)
+					n = (nul = memchr(s, '\0', cv.prec)) ? (size_t)(nul - s) : (size_t)cv.prec;
+				else
+					n = strlen(s);
+
+				if (fmtmem(sp, &cv, s, n))
+					return -1;
+			}
+
+			break;
+		case 'v': {
+			spx v = va_arg(a->ap, spx);
+
+			n = 0 <= cv.prec ? internal_min(v.len, cv.prec) : v.len;
+			if (fmtmem(sp, &cv, rebase(sp, a, v.mem), n))
+				return -1;
+
+			break;
+		}
+		case 'p':
+			arg.p = va_arg(a->ap, void *);
+			if (fmtlibc(sp, &cv, &arg))
+				return -1;
+
+			break;
+		case 'a':
+		case 'A':
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+			if (LEN_BIGL == cv.len)
+				arg.ld = va_arg(a->ap, long double);
+			else
+				arg.d = va_arg(a->ap, double);
+
+			if (fmtlibc(sp, &cv, &arg))
+				return -1;
+
+			break;
+		case 'n':
+			fmtcount(cv.len, sp->len - a->start, a);
+			break;
+		default:
+			errno = EINVAL;
+			return -1;
+		}
+	}
+}
+
+int
+stxvappf(stx *sp, const char *fmt, va_list ap)
+{
+	size_t len = sp->len;
+	struct args a;
+	int ret;
+
+	if (internal_own(sp))
+		return -1;
+
+	va_copy(a.ap, ap);
+	a.start = len;
+	a.mem = (uintptr_t)sp->mem;
+	a.size = sp->size;
+	ret = format(sp, fmt, &a);
+	va_end(a.ap);
+
+	// The null-terminator isn't counted, and a failed call appends nothing.
+	if (ret || reserve(sp, 0, NULL)) {
+		sp->len = len;
+		return -1;
+	}
+
+	sp->mem[sp->len] = '\0';
+
+	return 0;
+}
+
+int
+stxappf(stx *sp, const char *fmt, ...)
+{
+	va_list ap;
+	int ret;
+
+	va_start(ap, fmt);
+	ret = stxvappf(sp, fmt, ap);
+	va_end(ap);
+
+	return ret;
+}
@@ -0,0 +1,130 @@
+// See LICENSE file for copyright and license details
+#include <errno.h>
+#include <sys/uio.h>
+
+#include "internal.h"
+
+// Total length of "n" segments, or SIZE_MAX if it overflows.
+static size_t
+segslen(const spx *segs, size_t n)
+{
+	size_t total = 0;
+
+	for (size_t i=0; i<n; ++i) {
+		if (internal_size_add_overflows(total, segs[i].len))
+			return SIZE_MAX;
+
+		total += segs[i].len;
+	}
+
+	return total;
+}
+
+static void
+segscpy(char *dst, const spx *segs, size_t n)
+{
+	for (size_t i=0; i<n; ++i) {
+		memcpy(dst, segs[i].mem, segs[i].len);
+		dst += segs[i].len;
+	}
+}
+
+// Same as segslen() and segscpy(), for buffers described by iovecs.
+static size_t
+iovlen(const struct iovec *iov, int cnt)
+{
+	size_t total = 0;
+
+	for (int i=0; i<cnt; ++i) {
+		if (internal_size_add_overflows(total, iov[i].iov_len))
+			return SIZE_MAX;
+
+		total += iov[i].iov_len;
+	}
+
+	return total;
+}
+
+static void
+iovcpy(char *dst, const struct iovec *iov, int cnt)
+{
+	for (int i=0; i<cnt; ++i) {
+		memcpy(dst, iov[i].iov_base, iov[i].iov_len);
+		dst += iov[i].iov_len;
+	}
+}
+
+// Grow "sp" once for "total" more bytes and open a gap of that size at "pos",
+// moving the bytes after it once.
+static int
+makeroom(stx *sp, size_t pos, size_t total)
+{
+	if (pos > sp->len) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (internal_size_add_overflows(sp->len, total))
+		return -1;
+
+	if (stxensuresize(sp, sp->len + total) || internal_own(sp))
+		return -1;
+
+	if (pos < sp->len) {
+		internal_stats_move(sp->len - pos);
+		memmove(sp->mem + pos + total, sp->mem + pos, sp->len - pos);
+	}
+
+	return 0;
+}
+
+int
+stxappv(stx *sp, const spx *segs, size_t n)
+{
+	size_t total = segslen(segs, n);
+
+	if (makeroom(sp, sp->len, total))
+		return -1;
+
+	segscpy(sp->mem + sp->len, segs, n);
+	sp->len += total;
+
+	return 0;
+}
+
+int
+stxinsv(stx *sp, size_t pos, const spx *segs, size_t n)
+{
+	size_t total = segslen(segs, n);
+
+	internal_stats_call(STXSTATS_INSV);
+
+	if (makeroom(sp, pos, total))
+		return -1;
+
+	segscpy(sp->mem + pos, segs, n);
+	sp->len += total;
+
+	return 0;
+}
+
+int
+stxappiov(stx *sp, const struct iovec *iov, int cnt)
+{
+	size_t total;
+
+	if (cnt < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	total = iovlen(iov, cnt);
+
+	if (makeroom(sp, sp->len, total))
+		return -1;
+
+	iovcpy(sp->mem + sp->len, iov, cnt);
+	sp->len += total;
+
+	return 0;
+}
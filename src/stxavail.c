@@ -1,8 +1,4 @@
 // See LICENSE file for copyright and license details
+// Defined in libstx.h, so LIBSTX_INLINE can inline it.
+#define LIBSTX_DEFINE_STXAVAIL
 #include "internal.h"
-
-size_t
-stxavail(stx *sp)
-{
-	return sp->size - sp->len;
-}
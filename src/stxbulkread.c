@@ -0,0 +1,368 @@
+// See LICENSE file for copyright and license details
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+// Number of threads used by the pread() fallback.
+#define THREADS 8
+
+// Account for "n" bytes read into a request, returns true if it is done.
+static bool
+filled(stxreadreq *rq, size_t n)
+{
+	rq->buf->len += n;
+	rq->data.len += n;
+
+	return 0 == n || rq->buf->len == rq->buf->size;
+}
+
+static void
+preadreq(stxreadreq *rq)
+{
+	ssize_t n;
+
+	// Full after a read through io_uring, which pread() would fail on pipes.
+	if (rq->err || rq->buf->len == rq->buf->size)
+		return;
+
+	do {
+		size_t want = rq->buf->size - rq->buf->len;
+		uint64_t off = rq->off + rq->data.len;
+
+		if (want > SSIZE_MAX)
+			want = SSIZE_MAX;
+
+		n = pread(rq->fd, rq->buf->mem + rq->buf->len, want, off);
+		if (-1 == n) {
+			if (EINTR == errno)
+				continue;
+
+			rq->err = errno;
+			return;
+		}
+	} while (!filled(rq, n));
+}
+
+struct pool {
+	stxreadreq *reqs;
+	size_t n;
+	atomic_size_t next;
+};
+
+static void *
+worker(void *arg)
+{
+	struct pool *pl = arg;
+	size_t i;
+
+	while ((i = atomic_fetch_add(&pl->next, 1)) < pl->n)
+		preadreq(pl->reqs + i);
+
+	return NULL;
+}
+
+static void
+readthreads(stxreadreq *reqs, size_t n)
+{
+	struct pool pl = {.reqs = reqs, .n = n};
+	pthread_t th[THREADS];
+	size_t nth = n < THREADS ? n : THREADS;
+	size_t i;
+
+	atomic_init(&pl.next, 0);
+
+	// Threads that can't be started are made up for by the caller.
+	for (i=0; i<nth; ++i) {
+		if (pthread_create(th + i, NULL, worker, &pl))
+			break;
+	}
+
+	worker(&pl);
+
+	while (i--)
+		pthread_join(th[i], NULL);
+}
+
+#if defined(__linux__) && !defined(LIBSTX_NO_URING)
+#include <poll.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define ENTRIES 64
+// Failed waits for the reads in flight retried with a growing sleep, before
+// waiting on the ring with poll() instead.
+#define RETRIES 8
+
+struct ring {
+	int fd;
+	unsigned *sqhead, *sqtail, *sqmask, *sqarray;
+	unsigned *cqhead, *cqtail, *cqmask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sqmem, *cqmem;
+	size_t sqlen, cqlen, sqeslen;
+};
+
+static void
+ringfree(struct ring *r)
+{
+	if (r->sqes)
+		munmap(r->sqes, r->sqeslen);
+	if (r->cqmem && r->cqmem != r->sqmem)
+		munmap(r->cqmem, r->cqlen);
+	if (r->sqmem)
+		munmap(r->sqmem, r->sqlen);
+	close(r->fd);
+}
+
+static int
+ringinit(struct ring *r)
+{
+	struct io_uring_params p = {0};
+	char *sq, *cq;
+
+	memset(r, 0, sizeof(*r));
+
+	// Fails on kernels without io_uring or where it is disabled.
+	r->fd = syscall(__NR_io_uring_setup, ENTRIES, &p);
+	if (r->fd < 0)
+		return -1;
+
+	r->sqlen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cqlen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP && r->cqlen > r->sqlen)
+		r->sqlen = r->cqlen;
+
+	r->sqmem = mmap(NULL, r->sqlen, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (MAP_FAILED == r->sqmem) {
+		r->sqmem = NULL;
+		goto fail;
+	}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		r->cqmem = r->sqmem;
+	} else {
+		r->cqmem = mmap(NULL, r->cqlen, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+		if (MAP_FAILED == r->cqmem) {
+			r->cqmem = NULL;
+			goto fail;
+		}
+	}
+
+	r->sqeslen = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = mmap(NULL, r->sqeslen, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (MAP_FAILED == r->sqes) {
+		r->sqes = NULL;
+		goto fail;
+	}
+
+	sq = r->sqmem;
+	cq = r->cqmem;
+	r->sqhead = (unsigned *)(sq + p.sq_off.head);
+	r->sqtail = (unsigned *)(sq + p.sq_off.tail);
+	r->sqmask = (unsigned *)(sq + p.sq_off.ring_mask);
+	r->sqarray = (unsigned *)(sq + p.sq_off.array);
+	r->cqhead = (unsigned *)(cq + p.cq_off.head);
+	r->cqtail = (unsigned *)(cq + p.cq_off.tail);
+	r->cqmask = (unsigned *)(cq + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+	return 0;
+
+fail:
+	ringfree(r);
+	return -1;
+}
+
+// Queue a read of the rest of a request, using IORING_OP_READV as it is
+// supported by every kernel having io_uring.
+static void
+ringqueue(struct ring *r, stxreadreq *rq, struct iovec *iov, size_t i)
+{
+	unsigned tail = *r->sqtail;
+	unsigned idx = tail & *r->sqmask;
+	struct io_uring_sqe *sqe = r->sqes + idx;
+	size_t want = rq->buf->size - rq->buf->len;
+
+	// The result of a read is reported as an int.
+	if (want > INT32_MAX)
+		want = INT32_MAX;
+
+	iov->iov_base = rq->buf->mem + rq->buf->len;
+	iov->iov_len = want;
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READV;
+	sqe->fd = rq->fd;
+	sqe->off = rq->off + rq->data.len;
+	sqe->addr = (uintptr_t)iov;
+	sqe->len = 1;
+	sqe->user_data = i;
+
+	r->sqarray[idx] = idx;
+	__atomic_store_n(r->sqtail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// Take back the reads queued but not submitted yet. Without SQPOLL the kernel
+// only consumes entries in io_uring_enter(), so they are still in the ring.
+static size_t
+ringunqueue(struct ring *r, size_t queued, size_t *freeslots, size_t nfree)
+{
+	unsigned tail = *r->sqtail;
+
+	for (; queued; --queued)
+		freeslots[nfree++] = r->sqes[--tail & *r->sqmask].user_data;
+
+	__atomic_store_n(r->sqtail, tail, __ATOMIC_RELEASE);
+
+	return nfree;
+}
+
+// Wait before looking for completions again, after io_uring_enter() failed to
+// wait for them "fails" times in a row.
+static void
+ringbackoff(struct ring *r, int fails)
+{
+	struct pollfd pfd = {.fd = r->fd, .events = POLLIN};
+	struct timespec ts = {0, 1000000L << (fails < RETRIES ? fails : RETRIES)};
+
+	// The ring is readable once a completion is posted, which the kernel
+	// does without io_uring_enter().
+	if (fails < RETRIES || -1 == poll(&pfd, 1, 100))
+		nanosleep(&ts, NULL);
+}
+
+static int
+readuring(stxreadreq *reqs, size_t n)
+{
+	struct iovec iov[ENTRIES];
+	size_t slot[ENTRIES];
+	size_t freeslots[ENTRIES];
+	size_t nfree = ENTRIES;
+	size_t next = 0;
+	size_t inflight = 0;
+	size_t queued = 0;
+	struct ring r;
+	int err = 0;
+	int fails = 0;
+	size_t i;
+
+	if (ringinit(&r))
+		return -1;
+
+	for (i=0; i<ENTRIES; ++i)
+		freeslots[i] = ENTRIES - 1 - i;
+
+	while (next < n || inflight) {
+		unsigned head, tail;
+		long ret;
+
+		// Keep the ring full, each in flight read owns an iovec slot.
+		for (; !err && next < n && nfree; ++next) {
+			size_t s;
+
+			if (reqs[next].err)
+				continue;
+
+			s = freeslots[--nfree];
+			slot[s] = next;
+			ringqueue(&r, reqs + next, iov + s, s);
+			++inflight;
+			++queued;
+		}
+
+		if (!inflight)
+			break;
+
+		ret = syscall(__NR_io_uring_enter, r.fd, queued, 1,
+			IORING_ENTER_GETEVENTS, NULL, 0);
+		if (ret >= 0) {
+			queued -= ret;
+			fails = 0;
+		} else if (err) {
+			// Draining can't stop before the kernel is done with the
+			// buffers, but doesn't spin on a failing wait.
+			if (EINTR != errno)
+				ringbackoff(&r, ++fails);
+		} else if (EINTR != errno && EAGAIN != errno && EBUSY != errno) {
+			// Nothing was submitted. The reads the kernel already has
+			// write into the buffers until they complete, so stop
+			// queueing and wait for them before tearing the ring down.
+			// The reads left are done with threads.
+			err = errno;
+			inflight -= queued;
+			nfree = ringunqueue(&r, queued, freeslots, nfree);
+			queued = 0;
+		}
+
+		head = *r.cqhead;
+		tail = __atomic_load_n(r.cqtail, __ATOMIC_ACQUIRE);
+		for (; head != tail; ++head) {
+			struct io_uring_cqe *cqe = r.cqes + (head & *r.cqmask);
+			size_t s = cqe->user_data;
+			stxreadreq *rq = reqs + slot[s];
+
+			if (cqe->res < 0 && -EINTR != cqe->res && -EAGAIN != cqe->res) {
+				rq->err = -cqe->res;
+			} else if ((cqe->res < 0 || !filled(rq, cqe->res)) && !err) {
+				// Short read, ask for the rest in the same slot.
+				ringqueue(&r, rq, iov + s, s);
+				++queued;
+				continue;
+			}
+
+			freeslots[nfree++] = s;
+			--inflight;
+		}
+		__atomic_store_n(r.cqhead, head, __ATOMIC_RELEASE);
+	}
+
+	ringfree(&r);
+
+	if (err) {
+		errno = err;
+		return -1;
+	}
+
+	return 0;
+}
+#endif
+
+int
+stxbulkread(stxreadreq *reqs, size_t n, int flags)
+{
+	size_t i;
+
+	for (i=0; i<n; ++i) {
+		reqs[i].err = internal_own(reqs[i].buf) ? ENOMEM : 0;
+		reqs[i].data.mem = reqs[i].buf->mem + reqs[i].buf->len;
+		reqs[i].data.len = 0;
+	}
+
+	// Without io_uring, or if it fails, read with threads. Requests done
+	// through io_uring are found full or at their end and left as they are.
+#if defined(__linux__) && !defined(LIBSTX_NO_URING)
+	if (flags & STXREAD_THREADS || readuring(reqs, n))
+		readthreads(reqs, n);
+#else
+	(void)flags;
+	readthreads(reqs, n);
+#endif
+
+	for (i=0; i<n; ++i) {
+		if (reqs[i].err)
+			return -1;
+	}
+
+	return 0;
+}
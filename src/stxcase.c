@@ -0,0 +1,48 @@
+// See LICENSE file for copyright and license details
+#include "internal.h"
+
+stx *
+stxtolower(stx *sp)
+{
+	if (internal_own(sp))
+		return sp;
+
+	internal_kern->flipcase(sp->mem, sp->mem, sp->len, 'A');
+
+	return sp;
+}
+
+stx *
+stxtoupper(stx *sp)
+{
+	if (internal_own(sp))
+		return sp;
+
+	internal_kern->flipcase(sp->mem, sp->mem, sp->len, 'a');
+
+	return sp;
+}
+
+stx *
+stxtolower_spx(stx *dst, const spx src)
+{
+	if (internal_own(dst))
+		return dst;
+
+	dst->len = internal_min(dst->size, src.len);
+	internal_kern->flipcase(dst->mem, src.mem, dst->len, 'A');
+
+	return dst;
+}
+
+stx *
+stxtoupper_spx(stx *dst, const spx src)
+{
+	if (internal_own(dst))
+		return dst;
+
+	dst->len = internal_min(dst->size, src.len);
+	internal_kern->flipcase(dst->mem, src.mem, dst->len, 'a');
+
+	return dst;
+}
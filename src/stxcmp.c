@@ -4,15 +4,36 @@
 bool
 stxcmp(const spx s1, const spx s2)
 {
-	size_t i;
+	if (s1.len != s2.len)
+		return false;
+
+	return 0 == s1.len || 0 == memcmp(s1.mem, s2.mem, s1.len);
+}
 
+bool
+stxicmp(const spx s1, const spx s2)
+{
 	if (s1.len != s2.len)
 		return false;
 
-	for (i=0; i<s1.len; ++i) {
-		if (s1.mem[i] != s2.mem[i])
-			return false;
+	return s1.len == internal_kern->imismatch(s1.mem, s2.mem, s1.len);
+}
+
+int
+stxicmp3(const spx s1, const spx s2)
+{
+	size_t n = internal_min(s1.len, s2.len);
+	size_t i = internal_kern->imismatch(s1.mem, s2.mem, n);
+
+	if (i < n) {
+		unsigned char c1 = internal_tolower(s1.mem[i]);
+		unsigned char c2 = internal_tolower(s2.mem[i]);
+
+		return c1 < c2 ? -1 : 1;
 	}
 
-	return true;
+	if (s1.len == s2.len)
+		return 0;
+
+	return s1.len < s2.len ? -1 : 1;
 }
@@ -0,0 +1,829 @@
+// See LICENSE file for copyright and license details
+#include "internal.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define X86
+#include <immintrin.h>
+
+// Kernels are compiled for their instruction set whatever the flags of the
+// build, and only ever called once the CPU is known to support it.
+#define TARGET(isa) __attribute__((target(isa)))
+#endif
+
+static size_t
+utf8len_scalar(const char *mem, size_t n)
+{
+	const uint64_t hi = UINT64_C(0x8080808080808080);
+	size_t cont = 0;
+	size_t i = 0;
+	uint64_t x;
+
+	// Continuation bytes have the high bit set and the next one clear.
+	for (; i + 8 <= n; i += 8) {
+		memcpy(&x, mem + i, 8);
+		cont += internal_popcount64(x & ~(x << 1) & hi);
+	}
+
+	for (; i < n; ++i)
+		cont += 0x80 == (mem[i] & 0xC0);
+
+	return n - cont;
+}
+
+static void
+flipcase_scalar(char *dst, const char *src, size_t n, unsigned char lo)
+{
+	uint64_t w[4];
+	size_t i = 0;
+	int j;
+
+	// 32 bytes at a time keeps 4 independent words in flight.
+	for (; i + 32 <= n; i += 32) {
+		memcpy(w, src + i, 32);
+		for (j=0; j<4; ++j)
+			w[j] ^= internal_swar_inrange(w[j], lo, lo + 25) >> 2;
+		memcpy(dst + i, w, 32);
+	}
+
+	for (; i + 8 <= n; i += 8) {
+		memcpy(w, src + i, 8);
+		w[0] ^= internal_swar_inrange(w[0], lo, lo + 25) >> 2;
+		memcpy(dst + i, w, 8);
+	}
+
+	for (; i < n; ++i) {
+		unsigned char c = src[i];
+
+		dst[i] = (unsigned char)(c - lo) < 26 ? c ^ 0x20 : c;
+	}
+}
+
+static size_t
+imismatch_scalar(const char *s1, const char *s2, size_t n)
+{
+	size_t i = 0;
+
+	// Words are loaded little-endian so the first differing byte is the
+	// lowest non-zero byte of their difference.
+	for (; i + 8 <= n; i += 8) {
+		uint64_t x = internal_swar_tolower(internal_load64le(s1 + i)) ^
+			internal_swar_tolower(internal_load64le(s2 + i));
+
+		if (x)
+			return i + internal_ctz64(x) / 8;
+	}
+
+	for (; i < n; ++i) {
+		if (internal_tolower(s1[i]) != internal_tolower(s2[i]))
+			break;
+	}
+
+	return i;
+}
+
+static size_t
+ichr_scalar(const char *mem, size_t n, unsigned char c)
+{
+	const uint64_t ones = UINT64_C(0x0101010101010101);
+	size_t i = 0;
+
+	// Bytes equal to "c" are the zero bytes of "x". Only bytes after a zero
+	// byte might be found when they aren't one, so the lowest is exact.
+	for (; i + 8 <= n; i += 8) {
+		uint64_t x = internal_swar_tolower(internal_load64le(mem + i)) ^ ones * c;
+		uint64_t m = (x - ones) & ~x & ones * 0x80;
+
+		if (m)
+			return i + internal_ctz64(m) / 8;
+	}
+
+	for (; i < n; ++i) {
+		if (c == internal_tolower(mem[i]))
+			break;
+	}
+
+	return i;
+}
+
+// Set the bit of each byte of "set" in a 256 bit map.
+static void
+charmap(uint64_t *map, const char *set, size_t len)
+{
+	size_t i;
+
+	memset(map, 0, 4 * sizeof(*map));
+	for (i=0; i<len; ++i) {
+		unsigned char c = set[i];
+
+		map[c >> 6] |= UINT64_C(1) << (c & 63);
+	}
+}
+
+static bool
+inmap(const uint64_t *map, unsigned char c)
+{
+	return map[c >> 6] >> (c & 63) & 1;
+}
+
+static size_t
+span_scalar(const char *mem, size_t n, const char *set, size_t len)
+{
+	uint64_t map[4];
+	size_t i = 0;
+
+	charmap(map, set, len);
+	while (i < n && inmap(map, mem[i]))
+		++i;
+
+	return i;
+}
+
+static size_t
+rspan_scalar(const char *mem, size_t n, const char *set, size_t len)
+{
+	uint64_t map[4];
+	size_t i = n;
+
+	charmap(map, set, len);
+	while (i && inmap(map, mem[i - 1]))
+		--i;
+
+	return n - i;
+}
+
+static size_t
+jsonesc_scalar(const char *mem, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= n; i += 8) {
+		uint64_t x = internal_load64le(mem + i);
+		uint64_t m = internal_swar_inrange(x, 0, 0x1F) |
+			internal_swar_inrange(x, '"', '"') | internal_swar_inrange(x, '\\', '\\');
+
+		if (m)
+			return i + internal_ctz64(m) / 8;
+	}
+
+	for (; i < n; ++i) {
+		unsigned char c = mem[i];
+
+		if (c < 0x20 || '"' == c || '\\' == c)
+			break;
+	}
+
+	return i;
+}
+
+// Letters, digits, '-', '.', '_' and '~'.
+static bool
+unreserved(unsigned char c)
+{
+	return (unsigned char)((c | 0x20) - 'a') < 26 || (unsigned char)(c - '0') < 10 ||
+		'-' == c || '.' == c || '_' == c || '~' == c;
+}
+
+static size_t
+urlenc_scalar(const char *mem, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= n; i += 8) {
+		uint64_t x = internal_load64le(mem + i);
+		uint64_t ok = internal_swar_inrange(internal_swar_tolower(x), 'a', 'z') |
+			internal_swar_inrange(x, '0', '9') | internal_swar_inrange(x, '-', '.') |
+			internal_swar_inrange(x, '_', '_') | internal_swar_inrange(x, '~', '~');
+		uint64_t m = ~ok & UINT64_C(0x8080808080808080);
+
+		if (m)
+			return i + internal_ctz64(m) / 8;
+	}
+
+	for (; i < n && unreserved(mem[i]); ++i)
+		;
+
+	return i;
+}
+
+static size_t
+chr2_scalar(const char *mem, size_t n, unsigned char c1, unsigned char c2)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= n; i += 8) {
+		uint64_t x = internal_load64le(mem + i);
+		uint64_t m = internal_swar_inrange(x, c1, c1) | internal_swar_inrange(x, c2, c2);
+
+		if (m)
+			return i + internal_ctz64(m) / 8;
+	}
+
+	for (; i < n; ++i) {
+		if (c1 == (unsigned char)mem[i] || c2 == (unsigned char)mem[i])
+			break;
+	}
+
+	return i;
+}
+
+#ifdef X86
+// Set the bytes of "v" that are ASCII letters from "lo" to "lo" + 25. Bytes
+// are biased to make an unsigned comparison out of a signed one.
+TARGET("sse2") static __m128i
+inrange_sse2(__m128i v, unsigned char lo)
+{
+	__m128i t = _mm_sub_epi8(v, _mm_set1_epi8(lo - 0x80));
+
+	return _mm_cmpgt_epi8(_mm_set1_epi8(26 - 0x80), t);
+}
+
+TARGET("sse2") static __m128i
+tolower_sse2(__m128i v)
+{
+	return _mm_or_si128(v, _mm_and_si128(inrange_sse2(v, 'A'), _mm_set1_epi8(0x20)));
+}
+
+TARGET("sse2") static size_t
+utf8len_sse2(const char *mem, size_t n)
+{
+	size_t cont = 0;
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(mem + i));
+
+		v = _mm_and_si128(v, _mm_set1_epi8((char)0xC0));
+		v = _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0x80));
+		cont += internal_popcount64(_mm_movemask_epi8(v));
+	}
+
+	return i - cont + utf8len_scalar(mem + i, n - i);
+}
+
+TARGET("sse2") static void
+flipcase_sse2(char *dst, const char *src, size_t n, unsigned char lo)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i flip = _mm_and_si128(inrange_sse2(v, lo), _mm_set1_epi8(0x20));
+
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(v, flip));
+	}
+
+	flipcase_scalar(dst + i, src + i, n - i, lo);
+}
+
+TARGET("sse2") static size_t
+imismatch_sse2(const char *s1, const char *s2, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i v1 = tolower_sse2(_mm_loadu_si128((const __m128i *)(s1 + i)));
+		__m128i v2 = tolower_sse2(_mm_loadu_si128((const __m128i *)(s2 + i)));
+		unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2)) ^ 0xFFFF;
+
+		if (m)
+			return i + internal_ctz64(m);
+	}
+
+	return i + imismatch_scalar(s1 + i, s2 + i, n - i);
+}
+
+TARGET("sse2") static size_t
+ichr_sse2(const char *mem, size_t n, unsigned char c)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i v = tolower_sse2(_mm_loadu_si128((const __m128i *)(mem + i)));
+		unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+
+		if (m)
+			return i + internal_ctz64(m);
+	}
+
+	return i + ichr_scalar(mem + i, n - i, c);
+}
+
+TARGET("sse2") static size_t
+jsonesc_sse2(const char *mem, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(mem + i));
+		__m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1F)), v);
+		__m128i quote = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+		__m128i bslash = _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'));
+		unsigned m = _mm_movemask_epi8(_mm_or_si128(ctl, _mm_or_si128(quote, bslash)));
+
+		if (m)
+			return i + internal_ctz64(m);
+	}
+
+	return i + jsonesc_scalar(mem + i, n - i);
+}
+
+// Set the bytes of "v" from "lo" to "lo" + "len" - 1.
+TARGET("sse2") static __m128i
+between_sse2(__m128i v, unsigned char lo, unsigned char len)
+{
+	__m128i t = _mm_sub_epi8(v, _mm_set1_epi8(lo - 0x80));
+
+	return _mm_cmpgt_epi8(_mm_set1_epi8(len - 0x80), t);
+}
+
+TARGET("sse2") static size_t
+urlenc_sse2(const char *mem, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(mem + i));
+		__m128i ok = _mm_or_si128(
+			_mm_or_si128(inrange_sse2(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a'),
+				between_sse2(v, '0', 10)),
+			_mm_or_si128(between_sse2(v, '-', 2),
+				_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')),
+					_mm_cmpeq_epi8(v, _mm_set1_epi8('~')))));
+		unsigned m = _mm_movemask_epi8(ok) ^ 0xFFFF;
+
+		if (m)
+			return i + internal_ctz64(m);
+	}
+
+	return i + urlenc_scalar(mem + i, n - i);
+}
+
+TARGET("sse2") static size_t
+chr2_sse2(const char *mem, size_t n, unsigned char c1, unsigned char c2)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(mem + i));
+		unsigned m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(c1)),
+			_mm_cmpeq_epi8(v, _mm_set1_epi8(c2))));
+
+		if (m)
+			return i + internal_ctz64(m);
+	}
+
+	return i + chr2_scalar(mem + i, n - i, c1, c2);
+}
+
+// PCMPESTRI finds the first or last byte that isn't any of up to 16 set bytes.
+// The masked polarity leaves the bytes past the end of a short block unset, so
+// 16 means every byte is in the set.
+#define SPAN_MODE (_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_MASKED_NEGATIVE_POLARITY)
+
+TARGET("sse4.2") static size_t
+span_sse42(const char *mem, size_t n, const char *set, size_t len)
+{
+	char buf[16] = {0};
+	__m128i s, v;
+	size_t i = 0;
+	int k;
+
+	if (len > 16)
+		return span_scalar(mem, n, set, len);
+
+	memcpy(buf, set, len);
+	s = _mm_loadu_si128((const __m128i *)buf);
+
+	for (; i + 16 <= n; i += 16) {
+		v = _mm_loadu_si128((const __m128i *)(mem + i));
+		k = _mm_cmpestri(s, len, v, 16, SPAN_MODE);
+		if (k < 16)
+			return i + k;
+	}
+
+	if (i == n)
+		return n;
+
+	// The last bytes are copied so nothing past the end is read.
+	memcpy(buf, mem + i, n - i);
+	v = _mm_loadu_si128((const __m128i *)buf);
+	k = _mm_cmpestri(s, len, v, n - i, SPAN_MODE);
+
+	return k < 16 ? i + k : n;
+}
+
+TARGET("sse4.2") static size_t
+rspan_sse42(const char *mem, size_t n, const char *set, size_t len)
+{
+	char buf[16] = {0};
+	__m128i s, v;
+	size_t i = n;
+	int k;
+
+	if (len > 16)
+		return rspan_scalar(mem, n, set, len);
+
+	memcpy(buf, set, len);
+	s = _mm_loadu_si128((const __m128i *)buf);
+
+	for (; i >= 16; i -= 16) {
+		v = _mm_loadu_si128((const __m128i *)(mem + i - 16));
+		k = _mm_cmpestri(s, len, v, 16, SPAN_MODE | _SIDD_MOST_SIGNIFICANT);
+		if (k < 16)
+			return n - (i - 16 + k + 1);
+	}
+
+	if (0 == i)
+		return n;
+
+	memcpy(buf, mem, i);
+	v = _mm_loadu_si128((const __m128i *)buf);
+	k = _mm_cmpestri(s, len, v, i, SPAN_MODE | _SIDD_MOST_SIGNIFICANT);
+
+	return k < 16 ? n - (k + 1) : n;
+}
+
+TARGET("avx2") static __m256i
+inrange_avx2(__m256i v, unsigned char lo)
+{
+	__m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8(lo - 0x80));
+
+	return _mm256_cmpgt_epi8(_mm256_set1_epi8(26 - 0x80), t);
+}
+
+TARGET("avx2") static __m256i
+tolower_avx2(__m256i v)
+{
+	return _mm256_or_si256(v, _mm256_and_si256(inrange_avx2(v, 'A'), _mm256_set1_epi8(0x20)));
+}
+
+TARGET("avx2,popcnt") static size_t
+utf8len_avx2(const char *mem, size_t n)
+{
+	size_t cont = 0;
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(mem + i));
+
+		v = _mm256_and_si256(v, _mm256_set1_epi8((char)0xC0));
+		v = _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)0x80));
+		cont += internal_popcount64((uint32_t)_mm256_movemask_epi8(v));
+	}
+
+	return i - cont + utf8len_sse2(mem + i, n - i);
+}
+
+TARGET("avx2") static void
+flipcase_avx2(char *dst, const char *src, size_t n, unsigned char lo)
+{
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i flip = _mm256_and_si256(inrange_avx2(v, lo), _mm256_set1_epi8(0x20));
+
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(v, flip));
+	}
+
+	flipcase_sse2(dst + i, src + i, n - i, lo);
+}
+
+TARGET("avx2") static size_t
+imismatch_avx2(const char *s1, const char *s2, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i v1 = tolower_avx2(_mm256_loadu_si256((const __m256i *)(s1 + i)));
+		__m256i v2 = tolower_avx2(_mm256_loadu_si256((const __m256i *)(s2 + i)));
+		uint32_t m = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, v2));
+
+		if (m)
+			return i + internal_ctz64(m);
+	}
+
+	return i + imismatch_sse2(s1 + i, s2 + i, n - i);
+}
+
+TARGET("avx2") static size_t
+ichr_avx2(const char *mem, size_t n, unsigned char c)
+{
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i v = tolower_avx2(_mm256_loadu_si256((const __m256i *)(mem + i)));
+		uint32_t m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+
+		if (m)
+			return i + internal_ctz64(m);
+	}
+
+	return i + ichr_sse2(mem + i, n - i, c);
+}
+
+TARGET("avx2") static size_t
+jsonesc_avx2(const char *mem, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(mem + i));
+		__m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1F)), v);
+		__m256i quote = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'));
+		__m256i bslash = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'));
+		uint32_t m = _mm256_movemask_epi8(_mm256_or_si256(ctl, _mm256_or_si256(quote, bslash)));
+
+		if (m)
+			return i + internal_ctz64(m);
+	}
+
+	return i + jsonesc_sse2(mem + i, n - i);
+}
+
+TARGET("avx2") static __m256i
+between_avx2(__m256i v, unsigned char lo, unsigned char len)
+{
+	__m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8(lo - 0x80));
+
+	return _mm256_cmpgt_epi8(_mm256_set1_epi8(len - 0x80), t);
+}
+
+TARGET("avx2") static size_t
+urlenc_avx2(const char *mem, size_t n)
+{
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(mem + i));
+		__m256i ok = _mm256_or_si256(
+			_mm256_or_si256(inrange_avx2(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a'),
+				between_avx2(v, '0', 10)),
+			_mm256_or_si256(between_avx2(v, '-', 2),
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')),
+					_mm256_cmpeq_epi8(v, _mm256_set1_epi8('~')))));
+		uint32_t m = ~(uint32_t)_mm256_movemask_epi8(ok);
+
+		if (m)
+			return i + internal_ctz64(m);
+	}
+
+	return i + urlenc_sse2(mem + i, n - i);
+}
+
+TARGET("avx2") static size_t
+chr2_avx2(const char *mem, size_t n, unsigned char c1, unsigned char c2)
+{
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(mem + i));
+		uint32_t m = _mm256_movemask_epi8(_mm256_or_si256(
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c1)),
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c2))));
+
+		if (m)
+			return i + internal_ctz64(m);
+	}
+
+	return i + chr2_sse2(mem + i, n - i, c1, c2);
+}
+
+// AVX-512 kernels handle the last bytes with masked loads and stores, which
+// don't fault on the bytes left out.
+#define AVX512 "avx512f,avx512bw,popcnt"
+
+static __mmask64
+tailmask(size_t n)
+{
+	return n >= 64 ? ~(__mmask64)0 : ((__mmask64)1 << n) - 1;
+}
+
+TARGET(AVX512) static __m512i
+tolower_avx512(__m512i v)
+{
+	__mmask64 k = _mm512_cmplt_epu8_mask(_mm512_sub_epi8(v, _mm512_set1_epi8('A')),
+		_mm512_set1_epi8(26));
+
+	return _mm512_mask_blend_epi8(k, v, _mm512_or_si512(v, _mm512_set1_epi8(0x20)));
+}
+
+TARGET(AVX512) static size_t
+utf8len_avx512(const char *mem, size_t n)
+{
+	size_t cont = 0;
+	size_t i;
+
+	for (i=0; i<n; i += 64) {
+		__m512i v = _mm512_maskz_loadu_epi8(tailmask(n - i), mem + i);
+
+		v = _mm512_and_si512(v, _mm512_set1_epi8((char)0xC0));
+		cont += internal_popcount64(_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8((char)0x80)));
+	}
+
+	return n - cont;
+}
+
+TARGET(AVX512) static void
+flipcase_avx512(char *dst, const char *src, size_t n, unsigned char lo)
+{
+	size_t i;
+
+	for (i=0; i<n; i += 64) {
+		__mmask64 m = tailmask(n - i);
+		__m512i v = _mm512_maskz_loadu_epi8(m, src + i);
+		__mmask64 k = _mm512_cmplt_epu8_mask(_mm512_sub_epi8(v, _mm512_set1_epi8(lo)),
+			_mm512_set1_epi8(26));
+
+		v = _mm512_xor_si512(v, _mm512_maskz_mov_epi8(k, _mm512_set1_epi8(0x20)));
+		_mm512_mask_storeu_epi8(dst + i, m, v);
+	}
+}
+
+TARGET(AVX512) static size_t
+imismatch_avx512(const char *s1, const char *s2, size_t n)
+{
+	size_t i;
+
+	for (i=0; i<n; i += 64) {
+		__mmask64 m = tailmask(n - i);
+		__m512i v1 = tolower_avx512(_mm512_maskz_loadu_epi8(m, s1 + i));
+		__m512i v2 = tolower_avx512(_mm512_maskz_loadu_epi8(m, s2 + i));
+		__mmask64 k = _mm512_cmpneq_epi8_mask(v1, v2);
+
+		if (k)
+			return i + internal_ctz64(k);
+	}
+
+	return n;
+}
+
+TARGET(AVX512) static size_t
+ichr_avx512(const char *mem, size_t n, unsigned char c)
+{
+	size_t i;
+
+	for (i=0; i<n; i += 64) {
+		__mmask64 m = tailmask(n - i);
+		__m512i v = tolower_avx512(_mm512_maskz_loadu_epi8(m, mem + i));
+		__mmask64 k = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(c)) & m;
+
+		if (k)
+			return i + internal_ctz64(k);
+	}
+
+	return n;
+}
+
+TARGET(AVX512) static size_t
+jsonesc_avx512(const char *mem, size_t n)
+{
+	size_t i;
+
+	for (i=0; i<n; i += 64) {
+		__mmask64 m = tailmask(n - i);
+		__m512i v = _mm512_maskz_loadu_epi8(m, mem + i);
+		__mmask64 k = _mm512_cmplt_epu8_mask(v, _mm512_set1_epi8(0x20)) |
+			_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('"')) |
+			_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\\'));
+
+		// Zeroed bytes past the end look like control bytes.
+		if ((k &= m))
+			return i + internal_ctz64(k);
+	}
+
+	return n;
+}
+
+TARGET(AVX512) static __mmask64
+between_avx512(__m512i v, unsigned char lo, unsigned char len)
+{
+	return _mm512_cmplt_epu8_mask(_mm512_sub_epi8(v, _mm512_set1_epi8(lo)),
+		_mm512_set1_epi8(len));
+}
+
+TARGET(AVX512) static size_t
+urlenc_avx512(const char *mem, size_t n)
+{
+	size_t i;
+
+	for (i=0; i<n; i += 64) {
+		__mmask64 m = tailmask(n - i);
+		__m512i v = _mm512_maskz_loadu_epi8(m, mem + i);
+		__mmask64 ok = between_avx512(_mm512_or_si512(v, _mm512_set1_epi8(0x20)), 'a', 26) |
+			between_avx512(v, '0', 10) | between_avx512(v, '-', 2) |
+			_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('_')) |
+			_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('~'));
+		__mmask64 k = ~ok & m;
+
+		if (k)
+			return i + internal_ctz64(k);
+	}
+
+	return n;
+}
+
+TARGET(AVX512) static size_t
+chr2_avx512(const char *mem, size_t n, unsigned char c1, unsigned char c2)
+{
+	size_t i;
+
+	for (i=0; i<n; i += 64) {
+		__mmask64 m = tailmask(n - i);
+		__m512i v = _mm512_maskz_loadu_epi8(m, mem + i);
+		__mmask64 k = (_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(c1)) |
+			_mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(c2))) & m;
+
+		if (k)
+			return i + internal_ctz64(k);
+	}
+
+	return n;
+}
+#endif
+
+static const struct internal_kernels kernels[] = {
+	[STXCPU_SCALAR] = {
+		utf8len_scalar, flipcase_scalar, imismatch_scalar, ichr_scalar,
+		span_scalar, rspan_scalar, jsonesc_scalar,
+		urlenc_scalar, chr2_scalar,
+	},
+#ifdef X86
+	[STXCPU_SSE2] = {
+		utf8len_sse2, flipcase_sse2, imismatch_sse2, ichr_sse2,
+		span_scalar, rspan_scalar, jsonesc_sse2,
+		urlenc_sse2, chr2_sse2,
+	},
+	[STXCPU_SSE42] = {
+		utf8len_sse2, flipcase_sse2, imismatch_sse2, ichr_sse2,
+		span_sse42, rspan_sse42, jsonesc_sse2,
+		urlenc_sse2, chr2_sse2,
+	},
+	[STXCPU_AVX2] = {
+		utf8len_avx2, flipcase_avx2, imismatch_avx2, ichr_avx2,
+		span_sse42, rspan_sse42, jsonesc_avx2,
+		urlenc_avx2, chr2_avx2,
+	},
+	[STXCPU_AVX512] = {
+		utf8len_avx512, flipcase_avx512, imismatch_avx512, ichr_avx512,
+		span_sse42, rspan_sse42, jsonesc_avx512,
+		urlenc_avx512, chr2_avx512,
+	},
+#endif
+};
+
+const struct internal_kernels *internal_kern = kernels + STXCPU_SCALAR;
+
+static int level = STXCPU_SCALAR;
+
+#ifdef X86
+static int
+detect(void)
+{
+	// Needed before libgcc's own constructor has run.
+	__builtin_cpu_init();
+
+	// The AVX levels are only reported if the OS saves their registers.
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		return STXCPU_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return STXCPU_AVX2;
+	if (__builtin_cpu_supports("sse4.2"))
+		return STXCPU_SSE42;
+	if (__builtin_cpu_supports("sse2"))
+		return STXCPU_SSE2;
+
+	return STXCPU_SCALAR;
+}
+
+// Pick the kernels before main(), so they never change while in use. The
+// LIBSTX_CPU environment variable lowers the level, to test the other kernels.
+__attribute__((constructor)) static void
+init(void)
+{
+	static const char *const names[] = {
+		[STXCPU_SCALAR] = "scalar",
+		[STXCPU_SSE2] = "sse2",
+		[STXCPU_SSE42] = "sse4.2",
+		[STXCPU_AVX2] = "avx2",
+		[STXCPU_AVX512] = "avx512",
+	};
+	const char *env = getenv("LIBSTX_CPU");
+	int i;
+
+	level = detect();
+
+	for (i=0; env && i<level; ++i) {
+		if (0 == strcmp(env, names[i]))
+			level = i;
+	}
+
+	internal_kern = kernels + level;
+}
+#endif
+
+int
+stxcpu(void)
+{
+	return level;
+}
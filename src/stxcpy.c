@@ -1,9 +1,13 @@
 // See LICENSE file for copyright and license details
 #include "internal.h"
+#include <stdarg.h>
 
 stx *
 stxcpy_mem(stx *sp, const void *src, size_t n)
 {
+	if (internal_own(sp))
+		return sp;
+
 	n = internal_min(sp->size, n);
 
 	memmove(sp->mem, src, n);
@@ -15,6 +19,9 @@ stxcpy_mem(stx *sp, const void *src, size_t n)
 stx *
 stxcpy_str(stx *sp, const char *src)
 {
+	if (internal_own(sp))
+		return sp;
+
 	sp->len = internal_strncpy(sp->mem, src, sp->size);
 
 	return sp;
@@ -25,3 +32,32 @@ stxcpy_spx(stx *dst, const spx src)
 {
 	return stxcpy_mem(dst, src.mem, src.len);
 }
+
+int
+stxvcpyf(stx *sp, const char *fmt, va_list ap)
+{
+	size_t len = sp->len;
+
+	// Format after the old contents, which the arguments may point into, and
+	// only replace them once that succeeded.
+	if (stxvappf(sp, fmt, ap))
+		return -1;
+
+	memmove(sp->mem, sp->mem + len, sp->len - len + 1);
+	sp->len -= len;
+
+	return 0;
+}
+
+int
+stxcpyf(stx *sp, const char *fmt, ...)
+{
+	va_list ap;
+	int ret;
+
+	va_start(ap, fmt);
+	ret = stxvcpyf(sp, fmt, ap);
+	va_end(ap);
+
+	return ret;
+}
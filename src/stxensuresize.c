@@ -4,17 +4,23 @@
 int
 stxensuresize(stx *sp, size_t n)
 {
+	internal_stats_call(STXSTATS_ENSURESIZE);
+
 	if (sp->size >= n)
 		return 0;
 
 	if (!sp->mem && !n) {
 		memset(sp, 0, sizeof(*sp));
 	} else {
-		char *tmp = realloc(sp->mem, n);
+		char *tmp;
+
+		if (internal_own(sp))
+			return -1;
 
-		if (!tmp)
+		if (!(tmp = realloc(sp->mem, n)))
 			return -1;
 
+		internal_stats_realloc(n, n - sp->size);
 		sp->mem = tmp;
 		sp->size = n;
 	}
@@ -5,7 +5,8 @@ spx
 stxfind_mem(const spx haystack, const void *needle, size_t len)
 {
 	spx slice = {0};
-	size_t i, j;
+	const char *p = haystack.mem;
+	const char *end;
 
 	if (0 == len)
 		return slice;
@@ -13,16 +14,16 @@ stxfind_mem(const spx haystack, const void *needle, size_t len)
 	if (haystack.len < len)
 		return slice;
 
-	for (i=0; i<haystack.len; ++i) {
-		for (j=i; j<i+len; ++j) {
-			if (haystack.mem[j] != ((const char *)needle)[j-i]) {
-				break;
-			}
+	// Jump from one occurrence of the first byte to the next with memchr(),
+	// which the libc vectorizes, and only compare the rest there.
+	end = haystack.mem + haystack.len - len + 1;
+	while ((p = memchr(p, *(const char *)needle, end - p))) {
+		if (0 == memcmp(p + 1, (const char *)needle + 1, len - 1)) {
+			size_t i = p - haystack.mem;
+			return stxslice(haystack, i, i + len);
 		}
 
-		if (j-i == len) {
-			return stxslice(haystack, i, j);
-		}
+		++p;
 	}
 
 	return slice;
@@ -45,3 +46,45 @@ stxfind_spx(const spx haystack, const spx needle)
 {
 	return stxfind_mem(haystack, needle.mem, needle.len);
 }
+
+spx
+stxifind_mem(const spx haystack, const void *needle, size_t len)
+{
+	const char *nd = needle;
+	spx slice = {0};
+	unsigned char first;
+	size_t last, i;
+
+	if (0 == len)
+		return slice;
+
+	if (haystack.len < len)
+		return slice;
+
+	// Look for the lower cased first byte, candidates are then compared in
+	// full.
+	first = internal_tolower(nd[0]);
+	last = haystack.len - len;
+	for (i=0; i<=last; ++i) {
+		i += internal_kern->ichr(haystack.mem + i, last + 1 - i, first);
+		if (i > last)
+			break;
+
+		if (len - 1 == internal_kern->imismatch(haystack.mem + i + 1, nd + 1, len - 1))
+			return stxslice(haystack, i, i + len);
+	}
+
+	return slice;
+}
+
+spx
+stxifind_str(const spx haystack, const char *needle)
+{
+	return stxifind_mem(haystack, needle, strlen(needle));
+}
+
+spx
+stxifind_spx(const spx haystack, const spx needle)
+{
+	return stxifind_mem(haystack, needle.mem, needle.len);
+}
@@ -4,5 +4,14 @@
 void
 stxfree(const stx *s1)
 {
+	// Shared memory is only freed by the last reference to it.
+	if (s1->rc) {
+		if (1 != atomic_fetch_sub_explicit(&s1->rc->refs, 1,
+		    memory_order_acq_rel))
+			return;
+
+		free(s1->rc);
+	}
+
 	free(s1->mem);
 }
@@ -0,0 +1,81 @@
+// See LICENSE file for copyright and license details
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+// Read more input at the end of the buffer, making room first by dropping the
+// lines already returned, or by doubling the buffer when a single line fills it.
+static int
+refill(stxreader *rd)
+{
+	stx *buf = &rd->buf;
+	ssize_t n;
+
+	if (internal_own(buf))
+		return -1;
+
+	if (rd->pos) {
+		internal_stats_move(buf->len - rd->pos);
+		memmove(buf->mem, buf->mem + rd->pos, buf->len - rd->pos);
+		buf->len -= rd->pos;
+		rd->scan -= rd->pos;
+		rd->pos = 0;
+	}
+
+	if (buf->len == buf->size && stxgrow(buf, buf->size ? buf->size : 4096))
+		return -1;
+
+	do {
+		n = read(rd->fd, buf->mem + buf->len, buf->size - buf->len);
+	} while (-1 == n && EINTR == errno);
+
+	if (-1 == n)
+		return -1;
+
+	if (0 == n)
+		rd->eof = true;
+
+	buf->len += n;
+
+	return 0;
+}
+
+int
+stxgetline(stxreader *rd, spx *line)
+{
+	const char *nl;
+
+	for (;;) {
+		// memchr() is vectorized by the libc, and only the bytes read since
+		// the last call are searched.
+		nl = rd->scan < rd->buf.len
+			? memchr(rd->buf.mem + rd->scan, '\n', rd->buf.len - rd->scan)
+			: NULL;
+		if (nl) {
+			line->mem = rd->buf.mem + rd->pos;
+			line->len = nl - line->mem;
+			rd->pos = rd->scan = nl - rd->buf.mem + 1;
+			return 1;
+		}
+
+		rd->scan = rd->buf.len;
+
+		if (rd->eof)
+			break;
+
+		if (refill(rd))
+			return -1;
+	}
+
+	// The last line might not end with a newline.
+	if (rd->pos == rd->buf.len)
+		return 0;
+
+	line->mem = rd->buf.mem + rd->pos;
+	line->len = rd->buf.len - rd->pos;
+	rd->pos = rd->buf.len;
+
+	return 1;
+}
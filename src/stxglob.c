@@ -0,0 +1,256 @@
+// See LICENSE file for copyright and license details
+#include <errno.h>
+
+#include "internal.h"
+
+/**
+ * A segment is the part of a pattern between two '*', one set of bytes per
+ * byte it matches. "lit" is its longest run of literal bytes, at "off" bytes
+ * into it, which is searched for to find where the segment may match.
+ */
+struct seg {
+	size_t set;
+	size_t n;
+	size_t off;
+	spx lit;
+};
+
+struct stxglob {
+	uint64_t (*sets)[4];
+	char *lits;
+	struct seg *segs;
+	// Segments, one more than the '*' of the pattern.
+	size_t nsegs;
+};
+
+static bool
+inset(const uint64_t *set, unsigned char c)
+{
+	return set[c >> 6] >> (c & 63) & 1;
+}
+
+static void
+add(uint64_t *set, unsigned char c)
+{
+	set[c >> 6] |= UINT64_C(1) << (c & 63);
+}
+
+/**
+ * Parse a bracket expression after its '['. Returns the bytes parsed, or 0 if
+ * there's no closing ']' and the '[' is a literal byte. "set" is only written
+ * once the ']' is found.
+ */
+static size_t
+bracket(const char *p, const char *end, uint64_t *set)
+{
+	const char *start = p;
+	uint64_t scratch[4] = {0};
+	bool neg = false;
+	int lo, hi, c, i;
+
+	if (p < end && ('!' == *p || '^' == *p)) {
+		neg = true;
+		++p;
+	}
+
+	// A ']' right after the '[' or "[!" is a byte of the set.
+	for (i=0; p < end && (']' != *p || !i); ++i) {
+		if ('\\' == *p && p + 1 < end)
+			++p;
+		lo = (unsigned char)*p++;
+		hi = lo;
+
+		if (end - p >= 2 && '-' == p[0] && ']' != p[1]) {
+			if ('\\' == p[1] && end - p >= 3)
+				++p;
+			hi = (unsigned char)p[1];
+			p += 2;
+		}
+
+		for (c=lo; c<=hi; ++c)
+			add(scratch, c);
+	}
+
+	if (p == end)
+		return 0;
+
+	for (i=0; i<4; ++i)
+		set[i] = neg ? ~scratch[i] : scratch[i];
+
+	return p + 1 - start;
+}
+
+// Record the longest literal run of each segment.
+static void
+literals(stxglob *g, const bool *literal)
+{
+	size_t i, k, run;
+
+	for (i=0; i<g->nsegs; ++i) {
+		struct seg *sg = g->segs + i;
+
+		for (k=0, run=0; k<sg->n; ++k) {
+			run = literal[sg->set + k] ? run + 1 : 0;
+			if (run > sg->lit.len) {
+				sg->off = k + 1 - run;
+				sg->lit = (spx){.mem = g->lits + sg->set + sg->off, .len = run};
+			}
+		}
+	}
+}
+
+int
+stxglobcomp(stxglob **gp, const spx pattern)
+{
+	const char *p = pattern.mem, *end = p + pattern.len;
+	stxglob *g;
+	bool *literal;
+	size_t n = 0;
+	size_t len;
+
+	// Neither sets nor segments outnumber the bytes of the pattern.
+	if (!(g = calloc(1, sizeof(*g))))
+		return -1;
+	g->sets = calloc(pattern.len + 1, sizeof(*g->sets));
+	g->lits = malloc(pattern.len + 1);
+	g->segs = calloc(pattern.len + 1, sizeof(*g->segs));
+	literal = malloc(pattern.len + 1);
+	if (!g->sets || !g->lits || !g->segs || !literal) {
+		free(literal);
+		stxglobfree(g);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	g->nsegs = 1;
+
+	while (p < end) {
+		uint64_t *set = g->sets[n];
+
+		literal[n] = false;
+
+		switch (*p) {
+		case '*':
+			// Runs of '*' are one.
+			while (p < end && '*' == *p)
+				++p;
+			g->segs[g->nsegs - 1].n = n - g->segs[g->nsegs - 1].set;
+			g->segs[g->nsegs++].set = n;
+			continue;
+		case '?':
+			memset(set, 0xFF, sizeof(*g->sets));
+			++p;
+			break;
+		case '[':
+			if ((len = bracket(p + 1, end, set))) {
+				p += len + 1;
+				break;
+			}
+			// fallthrough
+		default:
+			if ('\\' == *p && p + 1 < end)
+				++p;
+			add(set, *p);
+			g->lits[n] = *p++;
+			literal[n] = true;
+			break;
+		}
+
+		++n;
+	}
+
+	g->segs[g->nsegs - 1].n = n - g->segs[g->nsegs - 1].set;
+	literals(g, literal);
+	free(literal);
+	*gp = g;
+
+	return 0;
+}
+
+static bool
+matchat(const stxglob *g, const struct seg *sg, const char *mem)
+{
+	size_t i;
+
+	for (i=0; i<sg->n; ++i) {
+		if (!inset(g->sets[sg->set + i], mem[i]))
+			return false;
+	}
+
+	return true;
+}
+
+// Find where a segment first matches in "sp", at its literal run's
+// occurrences if it has one. Returns the offset of the match, or SIZE_MAX.
+static size_t
+find(const stxglob *g, const struct seg *sg, const spx sp)
+{
+	size_t at, from, limit;
+	spx found;
+
+	if (sp.len < sg->n)
+		return SIZE_MAX;
+
+	if (!sg->lit.len) {
+		for (at=0; at + sg->n <= sp.len; ++at) {
+			if (matchat(g, sg, sp.mem + at))
+				return at;
+		}
+		return SIZE_MAX;
+	}
+
+	// The run lies between "off" and the bytes after it in every match.
+	limit = sp.len - (sg->n - sg->off - sg->lit.len);
+	for (from=sg->off; from < limit; from = at + sg->off + 1) {
+		if (!(found = stxfind_spx(stxslice(sp, from, limit), sg->lit)).mem)
+			break;
+
+		at = found.mem - sp.mem - sg->off;
+		if (sg->n == sg->lit.len || matchat(g, sg, sp.mem + at))
+			return at;
+	}
+
+	return SIZE_MAX;
+}
+
+/**
+ * The first segment matches at the start and the last one at the end. Since
+ * '*' matches anything, the segments between match wherever they first match
+ * after the segment before, and are never tried anywhere else.
+ */
+bool
+stxglobmatch(const stxglob *g, const spx sp)
+{
+	const struct seg *first = g->segs, *last = g->segs + g->nsegs - 1;
+	size_t pos, end, at, i;
+
+	if (1 == g->nsegs)
+		return sp.len == first->n && matchat(g, first, sp.mem);
+
+	if (sp.len < first->n + last->n || !matchat(g, first, sp.mem) ||
+	    !matchat(g, last, sp.mem + sp.len - last->n))
+		return false;
+
+	pos = first->n;
+	end = sp.len - last->n;
+
+	for (i=1; i<g->nsegs - 1; ++i) {
+		if (SIZE_MAX == (at = find(g, g->segs + i, stxslice(sp, pos, end))))
+			return false;
+		pos += at + g->segs[i].n;
+	}
+
+	return true;
+}
+
+void
+stxglobfree(stxglob *g)
+{
+	if (!g)
+		return;
+
+	free(g->sets);
+	free(g->lits);
+	free(g->segs);
+	free(g);
+}
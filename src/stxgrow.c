@@ -4,6 +4,8 @@
 int
 stxgrow(stx *sp, size_t n)
 {
+	internal_stats_call(STXSTATS_GROW);
+
 	if (internal_size_add_overflows(sp->size, n)) {
 		n = SIZE_MAX;
 	} else {
@@ -13,11 +15,15 @@ stxgrow(stx *sp, size_t n)
 	if (!sp->mem && !n) {
 		memset(sp, 0, sizeof(*sp));
 	} else {
-		char *tmp = realloc(sp->mem, n);
+		char *tmp;
+
+		if (internal_own(sp))
+			return -1;
 
-		if (!tmp)
+		if (!(tmp = realloc(sp->mem, n)))
 			return -1;
 
+		internal_stats_realloc(n, n - sp->size);
 		sp->mem = tmp;
 		sp->size = n;
 	}
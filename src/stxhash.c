@@ -0,0 +1,89 @@
+// See LICENSE file for copyright and license details
+#include "internal.h"
+
+static const uint64_t P0 = UINT64_C(0xa0761d6478bd642f);
+static const uint64_t P1 = UINT64_C(0xe7037ed1a0b428db);
+static const uint64_t P2 = UINT64_C(0x8ebc6af09c88c6e3);
+static const uint64_t P3 = UINT64_C(0x589965cc75374cc3);
+
+// Fold the 128 bit product of "a" and "b" into 64 bits.
+static uint64_t
+mum(uint64_t a, uint64_t b)
+{
+	uint64_t hi;
+	uint64_t lo = internal_mul128(a, b, &hi);
+
+	return lo ^ hi;
+}
+
+// Load the last "n" bytes, less than 8, zero padded.
+static uint64_t
+loadtail(const char *mem, size_t n)
+{
+	char buf[8] = {0};
+
+	memcpy(buf, mem, n);
+
+	return internal_load64le(buf);
+}
+
+/**
+ * Hash a block with 2 independent multiply chains of 16 bytes each, the
+ * index of the block seeding them so that equal blocks at different places
+ * hash differently.
+ */
+static uint64_t
+block(const char *mem, size_t n, uint64_t index)
+{
+	uint64_t h1 = P0 ^ index * P1;
+	uint64_t h2 = P2 ^ index * P3;
+	uint64_t a, b;
+	size_t i = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		h1 = mum(internal_load64le(mem + i) ^ P1, internal_load64le(mem + i + 8) ^ h1);
+		h2 = mum(internal_load64le(mem + i + 16) ^ P3, internal_load64le(mem + i + 24) ^ h2);
+	}
+
+	for (; i + 16 <= n; i += 16)
+		h1 = mum(internal_load64le(mem + i) ^ P1, internal_load64le(mem + i + 8) ^ h1);
+
+	if (i + 8 <= n) {
+		a = internal_load64le(mem + i);
+		b = loadtail(mem + i + 8, n - i - 8);
+	} else {
+		a = loadtail(mem + i, n - i);
+		b = 0;
+	}
+
+	h2 = mum(a ^ P0 ^ h2, b ^ P2 ^ n);
+
+	return mum(h1 ^ P3, h2 ^ P1);
+}
+
+uint64_t
+internal_hash_blocks(const char *mem, size_t n, uint64_t index)
+{
+	uint64_t sum = 0;
+	size_t len;
+
+	// A sum of block hashes adds up the same whichever thread hashed them.
+	for (; n; n -= len, mem += len, ++index) {
+		len = internal_min(n, INTERNAL_HASH_BLOCK);
+		sum += block(mem, len, index);
+	}
+
+	return sum;
+}
+
+uint64_t
+internal_hash_final(uint64_t sum, size_t n)
+{
+	return mum(sum ^ P2, (uint64_t)n ^ P0);
+}
+
+uint64_t
+stxhash(const spx sp)
+{
+	return internal_hash_final(internal_hash_blocks(sp.mem, sp.len, 0), sp.len);
+}
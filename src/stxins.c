@@ -4,11 +4,18 @@
 stx *
 stxins_mem(stx *sp, size_t pos, const void *src, size_t n)
 {
+	internal_stats_call(STXSTATS_INS);
+
+	if (internal_own(sp))
+		return sp;
+
 	n = internal_min(sp->size, n);
 
 	// Create some space if inserting before the end of the buffer.
-	if (pos < sp->len)
+	if (pos < sp->len) {
+		internal_stats_move(sp->len - pos);
 		memmove(sp->mem + pos + n, sp->mem + pos, sp->len - pos);
+	}
 
 	memmove(sp->mem + pos, src, n);
 	sp->len += n;
@@ -0,0 +1,46 @@
+// See LICENSE file for copyright and license details
+#include "internal.h"
+
+int
+stxjoin(stx *sp, const spx *parts, size_t n, const spx sep)
+{
+	size_t total = 0;
+	char *p;
+
+	if (0 == n)
+		return 0;
+
+	for (size_t i=0; i<n; ++i) {
+		if (internal_size_add_overflows(total, parts[i].len))
+			return -1;
+
+		total += parts[i].len;
+	}
+
+	if (sep.len && n - 1 > (SIZE_MAX - total) / sep.len)
+		return -1;
+
+	total += (n - 1) * sep.len;
+
+	if (internal_size_add_overflows(sp->len, total))
+		return -1;
+
+	// Grow once to the exact size, so copying needs no more checks.
+	if (stxensuresize(sp, sp->len + total) || internal_own(sp))
+		return -1;
+
+	p = sp->mem + sp->len;
+	memcpy(p, parts[0].mem, parts[0].len);
+	p += parts[0].len;
+
+	for (size_t i=1; i<n; ++i) {
+		memcpy(p, sep.mem, sep.len);
+		p += sep.len;
+		memcpy(p, parts[i].mem, parts[i].len);
+		p += parts[i].len;
+	}
+
+	sp->len += total;
+
+	return 0;
+}
@@ -0,0 +1,182 @@
+// See LICENSE file for copyright and license details
+#include <errno.h>
+
+#include "internal.h"
+
+// The short escape of a byte, or 0 if it is escaped as \u00XX.
+static char
+shortesc(unsigned char c)
+{
+	switch (c) {
+	case '"': return '"';
+	case '\\': return '\\';
+	case '\b': return 'b';
+	case '\f': return 'f';
+	case '\n': return 'n';
+	case '\r': return 'r';
+	case '\t': return 't';
+	}
+
+	return 0;
+}
+
+// Length of the escaped "src", or SIZE_MAX if it overflows.
+static size_t
+escapedlen(const spx src)
+{
+	size_t len = src.len;
+	size_t i = 0;
+
+	while ((i += internal_kern->jsonesc(src.mem + i, src.len - i)) < src.len) {
+		size_t extra = shortesc(src.mem[i++]) ? 1 : 5;
+
+		if (internal_size_add_overflows(len, extra))
+			return SIZE_MAX;
+		len += extra;
+	}
+
+	return len;
+}
+
+// The escaped bytes are counted first, so the stx grows at most once, and the
+// runs between them are copied whole.
+int
+stxapp_jsonesc(stx *sp, const spx src)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t len = escapedlen(src);
+	size_t i = 0;
+	size_t run;
+	char *dst;
+
+	if (SIZE_MAX == len || internal_size_add_overflows(sp->len, len))
+		return -1;
+
+	if (stxensuresize(sp, sp->len + len) || internal_own(sp))
+		return -1;
+
+	dst = sp->mem + sp->len;
+
+	while (i < src.len) {
+		unsigned char c;
+
+		run = internal_kern->jsonesc(src.mem + i, src.len - i);
+		memcpy(dst, src.mem + i, run);
+		dst += run;
+		if ((i += run) == src.len)
+			break;
+
+		c = src.mem[i++];
+		*dst++ = '\\';
+		if ((*dst = shortesc(c))) {
+			++dst;
+		} else {
+			memcpy(dst, "u00", 3);
+			dst[3] = hex[c >> 4];
+			dst[4] = hex[c & 0xF];
+			dst += 5;
+		}
+	}
+
+	sp->len += len;
+
+	return 0;
+}
+
+// The code unit of a \uXXXX escape at "mem", or -1.
+static long
+unit(const char *mem, size_t n)
+{
+	long u = 0;
+	size_t i;
+
+	if (n < 6 || '\\' != mem[0] || 'u' != mem[1])
+		return -1;
+
+	for (i=2; i<6; ++i) {
+		char c = mem[i];
+
+		if (c >= '0' && c <= '9')
+			u = u << 4 | (c - '0');
+		else if (c >= 'a' && c <= 'f')
+			u = u << 4 | (c - 'a' + 10);
+		else if (c >= 'A' && c <= 'F')
+			u = u << 4 | (c - 'A' + 10);
+		else
+			return -1;
+	}
+
+	return u;
+}
+
+// Unescaped strings are never longer, so the stx grows at most once. Nothing is
+// appended if an escape is invalid.
+int
+stxapp_jsonunesc(stx *sp, const spx src)
+{
+	const char *p = src.mem, *end = p + src.len, *bs;
+	char *dst;
+	long u, lo;
+	size_t n;
+
+	if (internal_size_add_overflows(sp->len, src.len))
+		return -1;
+
+	if (stxensuresize(sp, sp->len + src.len) || internal_own(sp))
+		return -1;
+
+	dst = sp->mem + sp->len;
+
+	while ((bs = memchr(p, '\\', end - p))) {
+		memcpy(dst, p, bs - p);
+		dst += bs - p;
+		p = bs;
+
+		if (end - p < 2)
+			goto invalid;
+
+		switch (p[1]) {
+		case '"':
+		case '\\':
+		case '/':
+			*dst++ = p[1];
+			break;
+		case 'b': *dst++ = '\b'; break;
+		case 'f': *dst++ = '\f'; break;
+		case 'n': *dst++ = '\n'; break;
+		case 'r': *dst++ = '\r'; break;
+		case 't': *dst++ = '\t'; break;
+		case 'u':
+			if (-1 == (u = unit(p, end - p)) || (u >= 0xDC00 && u <= 0xDFFF))
+				goto invalid;
+
+			// A high surrogate is followed by the low one of its pair.
+			if (u >= 0xD800 && u <= 0xDBFF) {
+				lo = unit(p + 6, end - p - 6);
+				if (lo < 0xDC00 || lo > 0xDFFF)
+					goto invalid;
+				u = 0x10000 + ((u - 0xD800) << 10) + (lo - 0xDC00);
+				p += 6;
+			}
+
+			n = stxutf8n32(u);
+			dst += stxutf8f32(dst, u, n);
+			p += 6;
+			continue;
+		default:
+			goto invalid;
+		}
+
+		p += 2;
+	}
+
+	memcpy(dst, p, end - p);
+	dst += end - p;
+	sp->len = dst - sp->mem;
+
+	return 0;
+
+invalid:
+	errno = EINVAL;
+	return -1;
+}
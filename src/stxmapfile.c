@@ -0,0 +1,87 @@
+// See LICENSE file for copyright and license details
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "internal.h"
+
+int
+stxmapfile(const char *path, spx *out, stxmap *mp, int hints)
+{
+	struct stat st;
+	void *addr;
+	int fd;
+	int err;
+
+	if (-1 == (fd = open(path, O_RDONLY | O_CLOEXEC)))
+		return -1;
+
+	if (-1 == fstat(fd, &st))
+		goto fail;
+
+	if (!S_ISREG(st.st_mode)) {
+		errno = EINVAL;
+		goto fail;
+	}
+
+	if ((uintmax_t)st.st_size > SIZE_MAX) {
+		errno = EFBIG;
+		goto fail;
+	}
+
+	// mmap() refuses empty mappings, an empty file is an empty spx.
+	if (0 == st.st_size) {
+		close(fd);
+		mp->addr = NULL;
+		mp->len = 0;
+		out->mem = NULL;
+		out->len = 0;
+		return 0;
+	}
+
+	addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (MAP_FAILED == addr)
+		goto fail;
+
+	// The mapping keeps its own reference to the file.
+	close(fd);
+
+	// Hints are advisory, failing to apply one is not an error.
+	if (hints & STXMAP_SEQUENTIAL)
+		posix_madvise(addr, st.st_size, POSIX_MADV_SEQUENTIAL);
+	if (hints & STXMAP_WILLNEED)
+		posix_madvise(addr, st.st_size, POSIX_MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+	if (hints & STXMAP_HUGEPAGE)
+		madvise(addr, st.st_size, MADV_HUGEPAGE);
+#endif
+
+	mp->addr = addr;
+	mp->len = st.st_size;
+	out->mem = addr;
+	out->len = st.st_size;
+
+	return 0;
+
+fail:
+	err = errno;
+	close(fd);
+	errno = err;
+
+	return -1;
+}
+
+int
+stxunmapfile(stxmap *mp)
+{
+	if (mp->addr && -1 == munmap(mp->addr, mp->len))
+		return -1;
+
+	mp->addr = NULL;
+	mp->len = 0;
+
+	return 0;
+}
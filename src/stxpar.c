@@ -0,0 +1,321 @@
+// See LICENSE file for copyright and license details
+#define _DEFAULT_SOURCE
+#include <pthread.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+// Most threads started for a call, and the smallest chunk worth a thread.
+#define THREADS 64
+#define CHUNK_MIN 65536
+
+struct pool {
+	void (*fn)(void *, size_t);
+	void *arg;
+	size_t n;
+	atomic_size_t next;
+};
+
+static void *
+worker(void *arg)
+{
+	struct pool *pl = arg;
+	size_t i;
+
+	while ((i = atomic_fetch_add(&pl->next, 1)) < pl->n)
+		pl->fn(pl->arg, i);
+
+	return NULL;
+}
+
+size_t
+internal_par_threads(const stxparopts *opts)
+{
+	long n;
+
+	if (opts && opts->threads)
+		return internal_min(opts->threads, THREADS);
+
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n < 1 ? 1 : internal_min(n, THREADS);
+}
+
+void
+internal_par(const stxparopts *opts, size_t n, void (*fn)(void *, size_t), void *arg)
+{
+	struct pool pl = {.fn = fn, .arg = arg, .n = n};
+	pthread_t th[THREADS];
+	size_t nth = internal_min(internal_par_threads(opts), n);
+	size_t i;
+
+	if (opts && opts->exec) {
+		opts->exec(opts->ctx, n, fn, arg);
+		return;
+	}
+
+	atomic_init(&pl.next, 0);
+
+	// The caller is one of the threads, and makes up for the threads that
+	// can't be started.
+	for (i=1; i<nth; ++i) {
+		if (pthread_create(th + i, NULL, worker, &pl))
+			break;
+	}
+
+	worker(&pl);
+
+	while (--i)
+		pthread_join(th[i], NULL);
+}
+
+// Whether a haystack is long enough to be split.
+static bool
+parallel(const stxparopts *opts, size_t len)
+{
+	size_t threshold = opts && opts->threshold ? opts->threshold : 1048576;
+
+	if (len < threshold)
+		return false;
+
+	return (opts && opts->exec) || internal_par_threads(opts) > 1;
+}
+
+/**
+ * Chunks start every "chunk" bytes and reach "len" - 1 bytes into the next, so
+ * each occurrence starts in exactly one of them. Several chunks per thread keep
+ * the threads busy until the end, and let them skip the chunks past a match.
+ */
+struct search {
+	spx hay;
+	spx needle;
+	size_t chunk;
+	atomic_size_t first;
+	atomic_size_t count;
+};
+
+static size_t
+chunks(struct search *s, const stxparopts *opts)
+{
+	size_t n = internal_par_threads(opts) * 8;
+
+	s->chunk = s->hay.len / n;
+	if (s->chunk < CHUNK_MIN)
+		s->chunk = CHUNK_MIN;
+	if (s->chunk < s->needle.len)
+		s->chunk = s->needle.len;
+
+	return (s->hay.len + s->chunk - 1) / s->chunk;
+}
+
+// Bytes of the haystack searched for occurrences starting in chunk "i".
+static spx
+chunkslice(struct search *s, size_t i)
+{
+	size_t begin = i * s->chunk;
+	size_t end = begin + s->chunk + s->needle.len - 1;
+
+	return stxslice(s->hay, begin, internal_min(end, s->hay.len));
+}
+
+static void
+findchunk(void *arg, size_t i)
+{
+	struct search *s = arg;
+	size_t first = atomic_load_explicit(&s->first, memory_order_relaxed);
+	spx found;
+	size_t at;
+
+	// A match was found in an earlier chunk.
+	if (i * s->chunk >= first)
+		return;
+
+	found = stxfind_spx(chunkslice(s, i), s->needle);
+	if (!found.mem)
+		return;
+
+	at = found.mem - s->hay.mem;
+	while (at < first && !atomic_compare_exchange_weak(&s->first, &first, at))
+		;
+}
+
+static void
+countchunk(void *arg, size_t i)
+{
+	struct search *s = arg;
+	spx rest = chunkslice(s, i);
+	size_t n = 0;
+	spx found;
+
+	while ((found = stxfind_spx(rest, s->needle)).mem) {
+		++n;
+		rest = stxslice(rest, found.mem - rest.mem + 1, rest.len);
+	}
+
+	atomic_fetch_add_explicit(&s->count, n, memory_order_relaxed);
+}
+
+spx
+stxfind_par(const spx haystack, const spx needle, const stxparopts *opts)
+{
+	struct search s = {.hay = haystack, .needle = needle};
+	spx slice = {0};
+	size_t first;
+
+	if (0 == needle.len || !parallel(opts, haystack.len))
+		return stxfind_spx(haystack, needle);
+
+	atomic_init(&s.first, SIZE_MAX);
+	atomic_init(&s.count, 0);
+	internal_par(opts, chunks(&s, opts), findchunk, &s);
+
+	first = atomic_load(&s.first);
+	if (SIZE_MAX != first)
+		slice = stxslice(haystack, first, first + needle.len);
+
+	return slice;
+}
+
+size_t
+stxcount_par(const spx haystack, const spx needle, const stxparopts *opts)
+{
+	struct search s = {.hay = haystack, .needle = needle};
+
+	if (0 == needle.len || haystack.len < needle.len)
+		return 0;
+
+	atomic_init(&s.first, SIZE_MAX);
+	atomic_init(&s.count, 0);
+
+	if (parallel(opts, haystack.len)) {
+		internal_par(opts, chunks(&s, opts), countchunk, &s);
+	} else {
+		s.chunk = haystack.len;
+		countchunk(&s, 0);
+	}
+
+	return atomic_load(&s.count);
+}
+
+/**
+ * Reductions split the input in chunks of a multiple of the hash block size,
+ * which each add their part of the result to "sum".
+ */
+struct reduce {
+	spx sp;
+	size_t chunk;
+	atomic_uint_least64_t sum;
+	atomic_bool invalid;
+};
+
+static size_t
+reducechunks(struct reduce *r, const stxparopts *opts)
+{
+	size_t n = internal_par_threads(opts) * 4;
+	size_t blocks = (r->sp.len / n + INTERNAL_HASH_BLOCK - 1) / INTERNAL_HASH_BLOCK;
+
+	r->chunk = (blocks ? blocks : 1) * INTERNAL_HASH_BLOCK;
+	atomic_init(&r->sum, 0);
+	atomic_init(&r->invalid, false);
+
+	return (r->sp.len + r->chunk - 1) / r->chunk;
+}
+
+static spx
+reduceslice(struct reduce *r, size_t i)
+{
+	size_t begin = i * r->chunk;
+
+	return stxslice(r->sp, begin, internal_min(begin + r->chunk, r->sp.len));
+}
+
+static void
+lenchunk(void *arg, size_t i)
+{
+	struct reduce *r = arg;
+
+	atomic_fetch_add_explicit(&r->sum, stxutf8len(reduceslice(r, i)),
+		memory_order_relaxed);
+}
+
+static void
+hashchunk(void *arg, size_t i)
+{
+	struct reduce *r = arg;
+	spx part = reduceslice(r, i);
+	uint64_t index = i * r->chunk / INTERNAL_HASH_BLOCK;
+
+	atomic_fetch_add_explicit(&r->sum,
+		internal_hash_blocks(part.mem, part.len, index), memory_order_relaxed);
+}
+
+// Move a chunk boundary past the continuation bytes of the encoding it falls
+// in. More than 3 of them are invalid anyway, and left to the chunk after.
+static size_t
+utf8boundary(const spx sp, size_t pos)
+{
+	size_t i;
+
+	for (i=0; i<3 && pos < sp.len; ++i, ++pos) {
+		if (0x80 != (sp.mem[pos] & 0xC0))
+			break;
+	}
+
+	return internal_min(pos, sp.len);
+}
+
+static void
+validchunk(void *arg, size_t i)
+{
+	struct reduce *r = arg;
+	size_t begin, end;
+
+	// An invalid chunk was found already.
+	if (atomic_load_explicit(&r->invalid, memory_order_relaxed))
+		return;
+
+	begin = utf8boundary(r->sp, i * r->chunk);
+	end = utf8boundary(r->sp, (i + 1) * r->chunk);
+
+	if (!stxutf8valid(stxslice(r->sp, begin, end)))
+		atomic_store_explicit(&r->invalid, true, memory_order_relaxed);
+}
+
+size_t
+stxutf8len_par(const spx sp, const stxparopts *opts)
+{
+	struct reduce r = {.sp = sp};
+
+	if (!parallel(opts, sp.len))
+		return stxutf8len(sp);
+
+	internal_par(opts, reducechunks(&r, opts), lenchunk, &r);
+
+	return atomic_load(&r.sum);
+}
+
+bool
+stxutf8valid_par(const spx sp, const stxparopts *opts)
+{
+	struct reduce r = {.sp = sp};
+
+	if (!parallel(opts, sp.len))
+		return stxutf8valid(sp);
+
+	internal_par(opts, reducechunks(&r, opts), validchunk, &r);
+
+	return !atomic_load(&r.invalid);
+}
+
+uint64_t
+stxhash_par(const spx sp, const stxparopts *opts)
+{
+	struct reduce r = {.sp = sp};
+
+	if (!parallel(opts, sp.len))
+		return stxhash(sp);
+
+	internal_par(opts, reducechunks(&r, opts), hashchunk, &r);
+
+	return internal_hash_final(atomic_load(&r.sum), sp.len);
+}
@@ -0,0 +1,1504 @@
+// See LICENSE file for copyright and license details
+#include <errno.h>
+
+#include "internal.h"
+
+// Limits of patterns: nesting of groups and repetitions, counted repetitions
+// and instructions of a compiled program, counted once more for each level of
+// loops that can repeat the empty string.
+#define DEPTH 200
+#define REPEAT 1000
+#define INSTS 20000
+// Bytes of states each DFA caches, the cache is emptied once full.
+#define CACHE 1048576
+#define BUCKETS 4096
+
+#define NONE SIZE_MAX
+
+/**
+ * Patterns are parsed to a tree first, which is compiled twice: forward for
+ * finding where matches end and for submatches, and backward for finding
+ * where they start.
+ */
+enum {
+	N_SET,    // A byte of set "arg".
+	N_CAT,    // The children in sequence.
+	N_ALT,    // One of the children, the first ones preferred.
+	N_REPEAT, // The child "min" to "max" times, no limit if "max" is -1.
+	N_GROUP,  // The child, captured as group "arg".
+	N_BEGIN,  // The start of the text.
+	N_END,    // The end of the text.
+};
+
+struct node {
+	int type;
+	int arg;
+	int min, max;
+	bool greedy;
+	int child; // First child, or -1.
+	int next;  // Next sibling, or -1.
+};
+
+enum {
+	I_SET,   // Consume a byte of set "x".
+	I_SPLIT, // Continue at "x", and with a lower priority at "y".
+	I_LOOP,  // I_SPLIT heading a loop that can repeat the empty string.
+	I_ITER,  // End an iteration of such a loop, see keyof().
+	I_JMP,   // Continue at "x".
+	I_SAVE,  // Store the position in capture slot "x".
+	I_BEGIN, // Continue if at the start of the scan.
+	I_END,   // Continue if at the end of the scan.
+	I_MATCH,
+};
+
+struct inst {
+	int op;
+	int x, y;
+};
+
+struct prog {
+	struct inst *insts;
+	int n;
+	int size;
+	// Nesting of the I_LOOP loops.
+	int depth;
+};
+
+/**
+ * A DFA state is the list of NFA threads waiting on a byte or on the end of
+ * the scan, in priority order, and whether a match ends where it is reached.
+ * Transitions are computed the first time they are taken, one per byte class.
+ */
+struct dstate {
+	struct dstate *chain;
+	int *insts;
+	uint32_t hash;
+	bool match;
+	int n;
+	struct dstate *next[];
+};
+
+struct dfa {
+	const struct prog *prog;
+	const uint64_t (*sets)[4];
+	const unsigned char *cls;
+	int ncls;
+	int pc;
+	// Keep the threads of lower priority than a match, to find the longest.
+	bool longest;
+	struct dstate *table[BUCKETS];
+	size_t bytes;
+	// Times the cache was emptied.
+	unsigned gen;
+	// Start states, when the start is at the start of the scan or not.
+	struct dstate *start[2];
+	// Scratch space of the closures: stack, sparse set of the instructions
+	// seen, and the thread list built.
+	int *stack;
+	int *sparse;
+	int *dense;
+	int nseen;
+	int *list;
+};
+
+struct stxre {
+	struct prog fwdprog;
+	struct prog revprog;
+	uint64_t (*sets)[4];
+	int nsets;
+	unsigned char cls[256];
+	int ngroups;
+	// Where matches start in the forward program, and the literal every
+	// match starts with. "literal" is set if it is the whole pattern.
+	int body;
+	spx prefix;
+	bool literal;
+	struct dfa fwd;
+	struct dfa rev;
+};
+
+struct parser {
+	const char *p;
+	const char *end;
+	struct node *nodes;
+	int nnodes;
+	int nodesize;
+	uint64_t (*sets)[4];
+	int nsets;
+	int setsize;
+	int ngroups;
+	int depth;
+	int err;
+};
+
+static bool
+inset(const uint64_t *set, unsigned char c)
+{
+	return set[c >> 6] >> (c & 63) & 1;
+}
+
+static void
+addrange(uint64_t *set, unsigned char lo, unsigned char hi)
+{
+	int c;
+
+	for (c=lo; c<=hi; ++c)
+		set[c >> 6] |= UINT64_C(1) << (c & 63);
+}
+
+static int
+newnode(struct parser *ps, int type)
+{
+	struct node *n;
+
+	if (ps->nnodes == ps->nodesize) {
+		int size = ps->nodesize ? ps->nodesize * 2 : 64;
+
+		if (!(n = realloc(ps->nodes, size * sizeof(*n)))) {
+			ps->err = ENOMEM;
+			return -1;
+		}
+
+		ps->nodes = n;
+		ps->nodesize = size;
+	}
+
+	n = ps->nodes + ps->nnodes;
+	memset(n, 0, sizeof(*n));
+	n->type = type;
+	n->child = -1;
+	n->next = -1;
+
+	return ps->nnodes++;
+}
+
+// A node of a new, empty, set.
+static int
+newset(struct parser *ps)
+{
+	void *sets;
+	int n;
+
+	if (ps->nsets == ps->setsize) {
+		int size = ps->setsize ? ps->setsize * 2 : 64;
+
+		if (!(sets = realloc(ps->sets, size * sizeof(*ps->sets)))) {
+			ps->err = ENOMEM;
+			return -1;
+		}
+
+		ps->sets = sets;
+		ps->setsize = size;
+	}
+
+	if (-1 == (n = newnode(ps, N_SET)))
+		return -1;
+
+	memset(ps->sets[ps->nsets], 0, sizeof(*ps->sets));
+	ps->nodes[n].arg = ps->nsets++;
+
+	return n;
+}
+
+static int
+fail(struct parser *ps)
+{
+	ps->err = EINVAL;
+	return -1;
+}
+
+static int
+hexdigit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/**
+ * Parse the escape after a backslash into "set". Returns the byte escaped, -2
+ * for escapes of several bytes like \d, or -1 on errors.
+ */
+static int
+escape(struct parser *ps, uint64_t *set)
+{
+	uint64_t tmp[4] = {0};
+	bool neg = false;
+	int c, hi, lo;
+
+	if (ps->p == ps->end)
+		return fail(ps);
+
+	switch ((c = (unsigned char)*ps->p++)) {
+	case 'D':
+		neg = true;
+		// fallthrough
+	case 'd':
+		addrange(tmp, '0', '9');
+		break;
+	case 'W':
+		neg = true;
+		// fallthrough
+	case 'w':
+		addrange(tmp, '0', '9');
+		addrange(tmp, 'A', 'Z');
+		addrange(tmp, 'a', 'z');
+		addrange(tmp, '_', '_');
+		break;
+	case 'S':
+		neg = true;
+		// fallthrough
+	case 's':
+		addrange(tmp, '\t', '\r');
+		addrange(tmp, ' ', ' ');
+		break;
+	case 'n': c = '\n'; goto byte;
+	case 't': c = '\t'; goto byte;
+	case 'r': c = '\r'; goto byte;
+	case 'f': c = '\f'; goto byte;
+	case 'v': c = '\v'; goto byte;
+	case 'x':
+		if (ps->end - ps->p < 2 || -1 == (hi = hexdigit(ps->p[0])) ||
+		    -1 == (lo = hexdigit(ps->p[1])))
+			return fail(ps);
+		ps->p += 2;
+		c = hi << 4 | lo;
+		goto byte;
+	default:
+		// Only punctuation is escaped as itself, letters are reserved.
+		if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') ||
+		    (c >= 'a' && c <= 'z'))
+			return fail(ps);
+	byte:
+		addrange(set, c, c);
+		return c;
+	}
+
+	for (c=0; c<4; ++c)
+		set[c] |= neg ? ~tmp[c] : tmp[c];
+
+	return -2;
+}
+
+// Parse a bracket expression, after the '['.
+static int
+bracket(struct parser *ps)
+{
+	uint64_t *set;
+	bool neg = false;
+	bool first = true;
+	int n, lo, hi, i;
+
+	if (-1 == (n = newset(ps)))
+		return -1;
+	set = ps->sets[ps->nodes[n].arg];
+
+	if (ps->p < ps->end && '^' == *ps->p) {
+		neg = true;
+		++ps->p;
+	}
+
+	// A ']' right after the '[' or "[^" is a byte of the set.
+	while (ps->p < ps->end && (']' != *ps->p || first)) {
+		first = false;
+
+		if ('\\' == *ps->p) {
+			++ps->p;
+			if (-2 == (lo = escape(ps, set)))
+				continue;
+			if (-1 == lo)
+				return -1;
+		} else {
+			lo = (unsigned char)*ps->p++;
+		}
+
+		if (ps->end - ps->p < 2 || '-' != ps->p[0] || ']' == ps->p[1]) {
+			addrange(set, lo, lo);
+			continue;
+		}
+
+		++ps->p;
+		if ('\\' == *ps->p) {
+			uint64_t tmp[4] = {0};
+
+			++ps->p;
+			if ((hi = escape(ps, tmp)) < 0)
+				return fail(ps);
+		} else {
+			hi = (unsigned char)*ps->p++;
+		}
+
+		if (lo > hi)
+			return fail(ps);
+		addrange(set, lo, hi);
+	}
+
+	if (ps->p == ps->end)
+		return fail(ps);
+	++ps->p;
+
+	if (neg) {
+		for (i=0; i<4; ++i)
+			set[i] = ~set[i];
+	}
+
+	return n;
+}
+
+static int alternation(struct parser *ps);
+
+static int
+atom(struct parser *ps)
+{
+	int n, sub, c;
+
+	switch ((c = (unsigned char)*ps->p++)) {
+	case '(':
+		if (++ps->depth > DEPTH)
+			return fail(ps);
+
+		if (ps->end - ps->p >= 2 && '?' == ps->p[0] && ':' == ps->p[1]) {
+			ps->p += 2;
+			n = -1;
+		} else if (-1 == (n = newnode(ps, N_GROUP))) {
+			return -1;
+		} else {
+			ps->nodes[n].arg = ++ps->ngroups;
+		}
+
+		if (-1 == (sub = alternation(ps)))
+			return -1;
+		if (ps->p == ps->end || ')' != *ps->p)
+			return fail(ps);
+		++ps->p;
+		--ps->depth;
+
+		if (-1 == n)
+			return sub;
+		ps->nodes[n].child = sub;
+		return n;
+	case '[':
+		return bracket(ps);
+	case '.':
+		if (-1 == (n = newset(ps)))
+			return -1;
+		addrange(ps->sets[ps->nodes[n].arg], 0, '\n' - 1);
+		addrange(ps->sets[ps->nodes[n].arg], '\n' + 1, 255);
+		return n;
+	case '^':
+		return newnode(ps, N_BEGIN);
+	case '$':
+		return newnode(ps, N_END);
+	case '*':
+	case '+':
+	case '?':
+		// Nothing to repeat.
+		return fail(ps);
+	case '\\':
+		if (-1 == (n = newset(ps)))
+			return -1;
+		if (-1 == escape(ps, ps->sets[ps->nodes[n].arg]))
+			return -1;
+		return n;
+	default:
+		if (-1 == (n = newset(ps)))
+			return -1;
+		addrange(ps->sets[ps->nodes[n].arg], c, c);
+		return n;
+	}
+}
+
+// Parse a decimal count of a repetition.
+static int
+count(struct parser *ps)
+{
+	int n = 0;
+
+	if (ps->p == ps->end || *ps->p < '0' || *ps->p > '9')
+		return -1;
+
+	while (ps->p < ps->end && *ps->p >= '0' && *ps->p <= '9') {
+		n = n * 10 + *ps->p++ - '0';
+		if (n > REPEAT)
+			return -1;
+	}
+
+	return n;
+}
+
+// Parse "{m}", "{m,}" or "{m,n}", a '{' not followed by a digit being a byte.
+static int
+braces(struct parser *ps, int *min, int *max)
+{
+	if (ps->end - ps->p < 2 || '{' != ps->p[0] || ps->p[1] < '0' || ps->p[1] > '9')
+		return 0;
+
+	++ps->p;
+	if (-1 == (*min = count(ps)))
+		return fail(ps);
+
+	*max = *min;
+	if (ps->p < ps->end && ',' == *ps->p) {
+		++ps->p;
+		*max = -1;
+		if (ps->p < ps->end && '}' != *ps->p && -1 == (*max = count(ps)))
+			return fail(ps);
+	}
+
+	if (ps->p == ps->end || '}' != *ps->p || (-1 != *max && *max < *min))
+		return fail(ps);
+	++ps->p;
+
+	return 1;
+}
+
+static int
+repetition(struct parser *ps)
+{
+	int n, r, min, max, depth = 0;
+
+	if (-1 == (n = atom(ps)))
+		return -1;
+
+	while (ps->p < ps->end) {
+		if ('*' == *ps->p) {
+			min = 0;
+			max = -1;
+			++ps->p;
+		} else if ('+' == *ps->p) {
+			min = 1;
+			max = -1;
+			++ps->p;
+		} else if ('?' == *ps->p) {
+			min = 0;
+			max = 1;
+			++ps->p;
+		} else if (1 != (r = braces(ps, &min, &max))) {
+			if (-1 == r)
+				return -1;
+			break;
+		}
+
+		if (ps->depth + ++depth > DEPTH || -1 == (r = newnode(ps, N_REPEAT)))
+			return -1 == r ? -1 : fail(ps);
+
+		ps->nodes[r].min = min;
+		ps->nodes[r].max = max;
+		ps->nodes[r].greedy = true;
+		ps->nodes[r].child = n;
+		if (ps->p < ps->end && '?' == *ps->p) {
+			ps->nodes[r].greedy = false;
+			++ps->p;
+		}
+
+		n = r;
+	}
+
+	return n;
+}
+
+static int
+concatenation(struct parser *ps)
+{
+	int cat, n, last = -1;
+
+	if (-1 == (cat = newnode(ps, N_CAT)))
+		return -1;
+
+	while (ps->p < ps->end && '|' != *ps->p && ')' != *ps->p) {
+		if (-1 == (n = repetition(ps)))
+			return -1;
+
+		if (-1 == last)
+			ps->nodes[cat].child = n;
+		else
+			ps->nodes[last].next = n;
+		last = n;
+	}
+
+	return cat;
+}
+
+static int
+alternation(struct parser *ps)
+{
+	int alt, n, last;
+
+	if (-1 == (last = concatenation(ps)))
+		return -1;
+	if (ps->p == ps->end || '|' != *ps->p)
+		return last;
+
+	if (-1 == (alt = newnode(ps, N_ALT)))
+		return -1;
+	ps->nodes[alt].child = last;
+
+	while (ps->p < ps->end && '|' == *ps->p) {
+		++ps->p;
+		if (-1 == (n = concatenation(ps)))
+			return -1;
+		ps->nodes[last].next = n;
+		last = n;
+	}
+
+	return alt;
+}
+
+struct gen {
+	struct prog *prog;
+	const struct node *nodes;
+	bool rev;
+	int depth;
+	int err;
+};
+
+static int
+emit(struct gen *g, int op, int x, int y)
+{
+	struct prog *pr = g->prog;
+
+	if (pr->n == INSTS) {
+		g->err = EINVAL;
+		return -1;
+	}
+
+	if (pr->n == pr->size) {
+		int size = pr->size ? pr->size * 2 : 64;
+		struct inst *in = realloc(pr->insts, size * sizeof(*in));
+
+		if (!in) {
+			g->err = ENOMEM;
+			return -1;
+		}
+
+		pr->insts = in;
+		pr->size = size;
+	}
+
+	pr->insts[pr->n] = (struct inst){.op = op, .x = x, .y = y};
+
+	return pr->n++;
+}
+
+static int compile(struct gen *g, int n);
+
+// Whether node "n" can match the empty string.
+static bool
+nullable(const struct node *nodes, int n)
+{
+	const struct node *nd = nodes + n;
+	int c;
+
+	switch (nd->type) {
+	case N_SET:
+		return false;
+	case N_CAT:
+		for (c=nd->child; -1 != c; c = nodes[c].next) {
+			if (!nullable(nodes, c))
+				return false;
+		}
+		return true;
+	case N_ALT:
+		for (c=nd->child; -1 != c; c = nodes[c].next) {
+			if (nullable(nodes, c))
+				return true;
+		}
+		return false;
+	case N_REPEAT:
+		return 0 == nd->min || nullable(nodes, nd->child);
+	case N_GROUP:
+		return nullable(nodes, nd->child);
+	}
+
+	// N_BEGIN and N_END.
+	return true;
+}
+
+static int
+compilecat(struct gen *g, int n)
+{
+	const struct node *nd = g->nodes;
+	int *kids;
+	int k = 0;
+	int c, i;
+
+	if (!g->rev) {
+		for (c=nd[n].child; -1 != c; c = nd[c].next) {
+			if (compile(g, c))
+				return -1;
+		}
+		return 0;
+	}
+
+	// Backward, the children are compiled last to first.
+	for (c=nd[n].child; -1 != c; c = nd[c].next)
+		++k;
+	if (!k)
+		return 0;
+	if (!(kids = malloc(k * sizeof(*kids)))) {
+		g->err = ENOMEM;
+		return -1;
+	}
+
+	for (i=0, c=nd[n].child; -1 != c; c = nd[c].next)
+		kids[i++] = c;
+	while (i--) {
+		if (compile(g, kids[i])) {
+			free(kids);
+			return -1;
+		}
+	}
+
+	free(kids);
+	return 0;
+}
+
+static int
+compilealt(struct gen *g, int n)
+{
+	const struct node *nd = g->nodes;
+	int chain = -1;
+	int c, split, j;
+
+	// Jumps to the end are chained through their target until it is known.
+	for (c=nd[n].child; -1 != nd[c].next; c = nd[c].next) {
+		if (-1 == (split = emit(g, I_SPLIT, g->prog->n + 1, -1)) ||
+		    compile(g, c) || -1 == (j = emit(g, I_JMP, chain, 0)))
+			return -1;
+		chain = j;
+		g->prog->insts[split].y = g->prog->n;
+	}
+
+	if (compile(g, c))
+		return -1;
+
+	while (-1 != chain) {
+		j = g->prog->insts[chain].x;
+		g->prog->insts[chain].x = g->prog->n;
+		chain = j;
+	}
+
+	return 0;
+}
+
+static int
+compilerepeat(struct gen *g, int n)
+{
+	const struct node *nd = g->nodes + n;
+	// Iterations matching the empty string end the loop, see keyof().
+	bool empty = nullable(g->nodes, nd->child);
+	int *heads;
+	int i, k, to, end;
+
+	for (i=0; i<nd->min; ++i) {
+		if (compile(g, nd->child))
+			return -1;
+	}
+
+	// The loop, or each optional repetition, can skip to the end.
+	if (!(k = -1 == nd->max ? 1 : nd->max - nd->min))
+		return 0;
+	if (!(heads = malloc(2 * k * sizeof(*heads)))) {
+		g->err = ENOMEM;
+		return -1;
+	}
+
+	g->depth += empty;
+	if (g->depth > g->prog->depth)
+		g->prog->depth = g->depth;
+
+	for (i=0; i<k; ++i) {
+		if (-1 == (heads[i] = emit(g, empty ? I_LOOP : I_SPLIT, g->prog->n + 1, -1)) ||
+		    compile(g, nd->child))
+			goto fail;
+
+		// The loop jumps back to its head, repetitions go on to the next.
+		to = -1 == nd->max ? heads[i] : g->prog->n + 1;
+		if (empty && -1 == (heads[k + i] = emit(g, I_ITER, to, -1)))
+			goto fail;
+		if (!empty && -1 == nd->max && -1 == emit(g, I_JMP, to, 0))
+			goto fail;
+	}
+
+	g->depth -= empty;
+
+	end = g->prog->n;
+	for (i=0; i<k; ++i) {
+		struct inst *in = g->prog->insts + heads[i];
+
+		if (nd->greedy) {
+			in->y = end;
+		} else {
+			in->y = in->x;
+			in->x = end;
+		}
+		if (empty)
+			g->prog->insts[heads[k + i]].y = end;
+	}
+
+	free(heads);
+	return 0;
+
+fail:
+	free(heads);
+	return -1;
+}
+
+static int
+compile(struct gen *g, int n)
+{
+	const struct node *nd = g->nodes + n;
+
+	switch (nd->type) {
+	case N_SET:
+		return -1 == emit(g, I_SET, nd->arg, 0) ? -1 : 0;
+	case N_CAT:
+		return compilecat(g, n);
+	case N_ALT:
+		return compilealt(g, n);
+	case N_REPEAT:
+		return compilerepeat(g, n);
+	case N_GROUP:
+		// Submatches are only extracted going forward.
+		if (g->rev)
+			return compile(g, nd->child);
+		if (-1 == emit(g, I_SAVE, 2 * nd->arg, 0) || compile(g, nd->child) ||
+		    -1 == emit(g, I_SAVE, 2 * nd->arg + 1, 0))
+			return -1;
+		return 0;
+	case N_BEGIN:
+		return -1 == emit(g, g->rev ? I_END : I_BEGIN, 0, 0) ? -1 : 0;
+	case N_END:
+		return -1 == emit(g, g->rev ? I_BEGIN : I_END, 0, 0) ? -1 : 0;
+	}
+
+	return 0;
+}
+
+// Split the bytes in classes that every set either includes or excludes
+// whole, so DFA states need one transition per class instead of per byte.
+static int
+byteclasses(stxre *re)
+{
+	int map[512];
+	int ncls = 1;
+	int i, c;
+
+	memset(re->cls, 0, sizeof(re->cls));
+
+	for (i=0; i<re->nsets; ++i) {
+		int n = 0;
+
+		for (c=0; c<2 * ncls; ++c)
+			map[c] = -1;
+
+		for (c=0; c<256; ++c) {
+			int key = re->cls[c] * 2 + inset(re->sets[i], c);
+
+			if (-1 == map[key])
+				map[key] = n++;
+			re->cls[c] = map[key];
+		}
+
+		ncls = n;
+	}
+
+	return ncls;
+}
+
+static uint32_t
+hashlist(const int *list, int n, bool match)
+{
+	uint32_t h = 2166136261u ^ match;
+	int i;
+
+	for (i=0; i<n; ++i)
+		h = (h ^ (uint32_t)list[i]) * 16777619u;
+
+	return h;
+}
+
+static void
+flush(struct dfa *d)
+{
+	struct dstate *s, *next;
+	int i;
+
+	for (i=0; i<BUCKETS; ++i) {
+		for (s=d->table[i]; s; s = next) {
+			next = s->chain;
+			free(s);
+		}
+		d->table[i] = NULL;
+	}
+
+	d->start[0] = d->start[1] = NULL;
+	d->bytes = 0;
+	++d->gen;
+}
+
+// Find the state of the thread list built in the scratch space, or add it.
+static struct dstate *
+intern(struct dfa *d, int n, bool match)
+{
+	uint32_t h = hashlist(d->list, n, match);
+	struct dstate **bucket = d->table + h % BUCKETS;
+	struct dstate *s;
+	size_t off, size;
+
+	for (s=*bucket; s; s = s->chain) {
+		if (s->hash == h && s->match == match && s->n == n &&
+		    0 == memcmp(s->insts, d->list, n * sizeof(*d->list)))
+			return s;
+	}
+
+	// The thread list follows the transitions.
+	off = sizeof(*s) + d->ncls * sizeof(*s->next);
+	size = off + n * sizeof(*d->list);
+
+	if (d->bytes + size > CACHE) {
+		flush(d);
+		bucket = d->table + h % BUCKETS;
+	}
+
+	if (!(s = calloc(1, size)))
+		return NULL;
+
+	s->insts = (int *)((char *)s + off);
+	s->hash = h;
+	s->match = match;
+	s->n = n;
+	memcpy(s->insts, d->list, n * sizeof(*d->list));
+
+	s->chain = *bucket;
+	*bucket = s;
+	d->bytes += size;
+
+	return s;
+}
+
+/**
+ * Threads are followed as keys, made of an instruction and of the number of
+ * I_LOOP loops around it whose iteration started in the same closure, the
+ * innermost ones. Such an iteration consumed nothing when it reaches its
+ * I_ITER, and leaves the loop at "y", as it does in a backtracking engine.
+ * Other iterations go on at "x", the head of the loop or of the next counted
+ * repetition.
+ */
+static int
+keyof(const struct prog *pr, int pc, int open)
+{
+	return open * pr->n + pc;
+}
+
+// The key the thread of "key" continues at, going from "pc" to "to".
+static int
+branch(const struct prog *pr, int key, int pc, int to)
+{
+	const struct inst *in = pr->insts + pc;
+	int open = key / pr->n;
+
+	// Iterations start right after the head.
+	if (I_LOOP == in->op && to == pc + 1)
+		return keyof(pr, to, open + 1);
+	if (I_ITER == in->op)
+		return open ? keyof(pr, in->y, open - 1) : keyof(pr, to, 0);
+
+	return keyof(pr, to, open);
+}
+
+/**
+ * Add the threads reached from "key" to the list in the scratch space, in
+ * priority order, depth first. Returns false once a match cuts the threads of
+ * lower priority, unless looking for the longest match.
+ */
+static bool
+follow(struct dfa *d, int key, bool atbegin, bool atend, int *n, bool *match)
+{
+	const struct prog *pr = d->prog;
+	int top = 0;
+	int pc;
+
+	d->stack[top++] = key;
+
+	while (top) {
+		const struct inst *in;
+
+		key = d->stack[--top];
+		pc = key % pr->n;
+		in = pr->insts + pc;
+
+		// Threads consuming a byte continue the same in any loop.
+		if (I_SET == in->op || I_MATCH == in->op)
+			key = pc;
+
+		if ((unsigned)d->sparse[key] < (unsigned)d->nseen && d->dense[d->sparse[key]] == key)
+			continue;
+		d->sparse[key] = d->nseen;
+		d->dense[d->nseen++] = key;
+
+		switch (in->op) {
+		case I_SPLIT:
+		case I_LOOP:
+			d->stack[top++] = branch(pr, key, pc, in->y);
+			d->stack[top++] = branch(pr, key, pc, in->x);
+			break;
+		case I_ITER:
+		case I_JMP:
+			d->stack[top++] = branch(pr, key, pc, in->x);
+			break;
+		case I_SAVE:
+			d->stack[top++] = key + 1;
+			break;
+		case I_BEGIN:
+			if (atbegin)
+				d->stack[top++] = key + 1;
+			break;
+		case I_END:
+			// Waits for the end of the scan, unless already there.
+			if (atend)
+				d->stack[top++] = key + 1;
+			else
+				d->list[(*n)++] = key;
+			break;
+		case I_SET:
+			d->list[(*n)++] = key;
+			break;
+		case I_MATCH:
+			*match = true;
+			if (!d->longest)
+				return false;
+			break;
+		}
+	}
+
+	return true;
+}
+
+static struct dstate *
+start(struct dfa *d, bool atbegin)
+{
+	int n = 0;
+	bool match = false;
+
+	if (!d->start[atbegin]) {
+		d->nseen = 0;
+		follow(d, d->pc, atbegin, false, &n, &match);
+		d->start[atbegin] = intern(d, n, match);
+	}
+
+	return d->start[atbegin];
+}
+
+// Compute the state after a byte, which might empty the cache.
+static struct dstate *
+step(struct dfa *d, struct dstate *s, unsigned char c)
+{
+	struct dstate *next;
+	int n = 0;
+	bool match = false;
+	unsigned gen = d->gen;
+	int i;
+
+	d->nseen = 0;
+	for (i=0; i<s->n; ++i) {
+		const struct inst *in = d->prog->insts + s->insts[i] % d->prog->n;
+
+		if (I_SET == in->op && inset(d->sets[in->x], c) &&
+		    !follow(d, s->insts[i] + 1, false, false, &n, &match))
+			break;
+	}
+
+	// The cache might have been emptied, freeing "s".
+	if ((next = intern(d, n, match)) && gen == d->gen)
+		s->next[d->cls[c]] = next;
+
+	return next;
+}
+
+// Whether the threads waiting on the end of the scan match there.
+static bool
+atend(struct dfa *d, const struct dstate *s, bool atbegin)
+{
+	int n = 0;
+	bool match = false;
+	int i;
+
+	d->nseen = 0;
+	for (i=0; i<s->n && !match; ++i) {
+		if (I_END == d->prog->insts[s->insts[i] % d->prog->n].op)
+			follow(d, s->insts[i] + 1, atbegin, true, &n, &match);
+	}
+
+	return match;
+}
+
+/**
+ * Find where the leftmost-first match ends. The forward program starts with a
+ * lazy loop over any byte, so threads starting later have a lower priority and
+ * are cut once a match is found. Whenever no match is in progress, the DFA is
+ * in its start state and skips to the next occurrence of the prefix.
+ */
+static int
+findend(stxre *re, const spx text, size_t *end)
+{
+	struct dfa *d = &re->fwd;
+	struct dstate *s, *next;
+	size_t last = NONE;
+	size_t i;
+
+	if (re->prefix.len && !start(d, false))
+		return -1;
+	if (!(s = start(d, true)))
+		return -1;
+	if (s->match)
+		last = 0;
+
+	for (i=0; i<text.len; ++i) {
+		if (s == d->start[false] && re->prefix.len) {
+			spx at = stxfind_spx(stxslice(text, i, text.len), re->prefix);
+
+			if (!at.mem)
+				goto out;
+			i = at.mem - text.mem;
+		}
+
+		if (!(next = s->next[d->cls[(unsigned char)text.mem[i]]]) &&
+		    !(next = step(d, s, text.mem[i])))
+			return -1;
+		s = next;
+		if (s->match)
+			last = i + 1;
+		if (0 == s->n)
+			goto out;
+	}
+
+	if (atend(d, s, 0 == text.len))
+		last = text.len;
+
+out:
+	*end = last;
+	return 0;
+}
+
+// Find where the match ending at "end" starts, the longest match of the
+// backward program being the leftmost start.
+static int
+findbegin(stxre *re, const spx text, size_t end, size_t *begin)
+{
+	struct dfa *d = &re->rev;
+	struct dstate *s, *next;
+	size_t i;
+
+	if (!(s = start(d, end == text.len)))
+		return -1;
+	*begin = s->match ? end : NONE;
+
+	for (i=end; i>0; --i) {
+		if (!(next = s->next[d->cls[(unsigned char)text.mem[i - 1]]]) &&
+		    !(next = step(d, s, text.mem[i - 1])))
+			return -1;
+		s = next;
+		if (s->match)
+			*begin = i - 1;
+		if (0 == s->n)
+			return 0;
+	}
+
+	if (atend(d, s, 0 == text.len))
+		*begin = 0;
+
+	return 0;
+}
+
+/**
+ * Pike VM: run the threads of the forward program in lock step from "begin",
+ * each with its own capture slots, to find the submatches of the match found
+ * by the DFAs.
+ */
+struct threads {
+	int *pcs;
+	size_t *caps;
+	int n;
+	unsigned *mark;
+};
+
+struct pike {
+	const stxre *re;
+	spx text;
+	int ncap;
+	unsigned stamp;
+	// Stack of keys to visit, see keyof(), and of capture slots to
+	// restore.
+	struct {
+		int key;
+		int slot;
+		size_t val;
+	} *stack;
+};
+
+static void
+addthread(struct pike *pk, struct threads *l, int pc, size_t *caps, size_t pos)
+{
+	const struct prog *pr = &pk->re->fwdprog;
+	int top = 0;
+	int key;
+
+	pk->stack[top].key = pc;
+	pk->stack[top++].slot = -1;
+
+	while (top) {
+		const struct inst *in;
+
+		--top;
+		key = pk->stack[top].key;
+		if (-1 == key) {
+			caps[pk->stack[top].slot] = pk->stack[top].val;
+			continue;
+		}
+
+		pc = key % pr->n;
+		in = pr->insts + pc;
+		if (I_SET == in->op || I_MATCH == in->op)
+			key = pc;
+
+		if (pk->stamp == l->mark[key])
+			continue;
+		l->mark[key] = pk->stamp;
+
+		switch (in->op) {
+		case I_SPLIT:
+		case I_LOOP:
+			pk->stack[top].key = branch(pr, key, pc, in->y);
+			pk->stack[top++].slot = -1;
+			pk->stack[top].key = branch(pr, key, pc, in->x);
+			pk->stack[top++].slot = -1;
+			break;
+		case I_ITER:
+		case I_JMP:
+			pk->stack[top].key = branch(pr, key, pc, in->x);
+			pk->stack[top++].slot = -1;
+			break;
+		case I_SAVE:
+			// The slot is restored once the threads after it are added.
+			pk->stack[top].key = -1;
+			pk->stack[top].slot = in->x;
+			pk->stack[top++].val = caps[in->x];
+			caps[in->x] = pos;
+			pk->stack[top].key = key + 1;
+			pk->stack[top++].slot = -1;
+			break;
+		case I_BEGIN:
+			if (0 == pos) {
+				pk->stack[top].key = key + 1;
+				pk->stack[top++].slot = -1;
+			}
+			break;
+		case I_END:
+			if (pk->text.len == pos) {
+				pk->stack[top].key = key + 1;
+				pk->stack[top++].slot = -1;
+			}
+			break;
+		case I_SET:
+		case I_MATCH:
+			l->pcs[l->n] = pc;
+			memcpy(l->caps + l->n * pk->ncap, caps, pk->ncap * sizeof(*caps));
+			++l->n;
+			break;
+		}
+	}
+}
+
+static int
+submatches(const stxre *re, const spx text, size_t begin, spx *match, size_t nsub)
+{
+	struct pike pk = {.re = re, .text = text, .ncap = 2 * (re->ngroups + 1)};
+	int ninsts = re->fwdprog.n;
+	int nkeys = keyof(&re->fwdprog, 0, re->fwdprog.depth + 1);
+	struct threads lists[2] = {0};
+	struct threads *cl = lists, *nl = lists + 1, *tmp;
+	size_t *caps, *best;
+	bool found = false;
+	size_t pos, i;
+	int ret = -1;
+	int j;
+
+	pk.stack = malloc(2 * (nkeys + 1) * sizeof(*pk.stack));
+	caps = malloc(2 * pk.ncap * sizeof(*caps));
+	for (j=0; j<2; ++j) {
+		lists[j].pcs = malloc(ninsts * sizeof(*lists[j].pcs));
+		lists[j].caps = malloc(ninsts * pk.ncap * sizeof(*lists[j].caps));
+		lists[j].mark = calloc(nkeys, sizeof(*lists[j].mark));
+		if (!lists[j].pcs || !lists[j].caps || !lists[j].mark)
+			goto out;
+	}
+	if (!pk.stack || !caps)
+		goto out;
+
+	best = caps + pk.ncap;
+	for (j=0; j<pk.ncap; ++j)
+		caps[j] = NONE;
+	caps[0] = begin;
+
+	++pk.stamp;
+	addthread(&pk, cl, re->body, caps, begin);
+
+	for (pos=begin; cl->n; ++pos) {
+		++pk.stamp;
+		nl->n = 0;
+
+		for (j=0; j<cl->n; ++j) {
+			const struct inst *in = re->fwdprog.insts + cl->pcs[j];
+			size_t *tc = cl->caps + j * pk.ncap;
+
+			// Threads of lower priority than a match are cut.
+			if (I_MATCH == in->op) {
+				memcpy(best, tc, pk.ncap * sizeof(*best));
+				best[1] = pos;
+				found = true;
+				break;
+			}
+
+			if (pos < text.len && inset(re->sets[in->x], text.mem[pos])) {
+				memcpy(caps, tc, pk.ncap * sizeof(*caps));
+				addthread(&pk, nl, cl->pcs[j] + 1, caps, pos + 1);
+			}
+		}
+
+		tmp = cl;
+		cl = nl;
+		nl = tmp;
+	}
+
+	for (i=0; found && i<nsub && i<(size_t)re->ngroups + 1; ++i) {
+		if (NONE != best[2 * i] && NONE != best[2 * i + 1])
+			match[i] = stxslice(text, best[2 * i], best[2 * i + 1]);
+	}
+
+	ret = found;
+
+out:
+	for (j=0; j<2; ++j) {
+		free(lists[j].pcs);
+		free(lists[j].caps);
+		free(lists[j].mark);
+	}
+	free(caps);
+	free(pk.stack);
+
+	return ret;
+}
+
+static int
+dfainit(stxre *re, struct dfa *d, const struct prog *prog, int pc, int ncls, bool longest)
+{
+	int nkeys = keyof(prog, 0, prog->depth + 1);
+
+	memset(d, 0, sizeof(*d));
+	d->prog = prog;
+	d->sets = (const uint64_t (*)[4])re->sets;
+	d->cls = re->cls;
+	d->ncls = ncls;
+	d->pc = pc;
+	d->longest = longest;
+
+	d->stack = malloc(2 * (nkeys + 1) * sizeof(*d->stack));
+	d->sparse = malloc(nkeys * sizeof(*d->sparse));
+	d->dense = malloc(nkeys * sizeof(*d->dense));
+	d->list = malloc(nkeys * sizeof(*d->list));
+
+	return d->stack && d->sparse && d->dense && d->list ? 0 : -1;
+}
+
+static void
+dfafree(struct dfa *d)
+{
+	flush(d);
+	free(d->stack);
+	free(d->sparse);
+	free(d->dense);
+	free(d->list);
+}
+
+// The byte of a set of one byte, or -1.
+static int
+single(const uint64_t *set)
+{
+	int i;
+
+	if (1 != internal_popcount64(set[0]) + internal_popcount64(set[1]) +
+	    internal_popcount64(set[2]) + internal_popcount64(set[3]))
+		return -1;
+
+	for (i=0; !set[i]; ++i)
+		;
+
+	return i * 64 + internal_ctz64(set[i]);
+}
+
+// Record the literal bytes every match starts with.
+static int
+prefix(stxre *re, const struct node *nodes, int root)
+{
+	const struct node *nd = nodes + root;
+	char *mem;
+	size_t n = 0;
+	int c, b;
+
+	if (N_CAT != nd->type || -1 == nd->child)
+		return 0;
+
+	for (c=nd->child; -1 != c; c = nodes[c].next)
+		++n;
+	if (!(mem = malloc(n)))
+		return -1;
+
+	n = 0;
+	for (c=nd->child; -1 != c && N_SET == nodes[c].type; c = nodes[c].next) {
+		if (-1 == (b = single(re->sets[nodes[c].arg])))
+			break;
+		mem[n++] = b;
+	}
+
+	re->literal = -1 == c;
+	re->prefix.mem = mem;
+	re->prefix.len = n;
+
+	return 0;
+}
+
+int
+stxrecomp(stxre **rep, const spx pattern)
+{
+	struct parser ps = {.p = pattern.mem, .end = pattern.mem + pattern.len};
+	struct gen g = {0};
+	stxre *re;
+	int root, any, ncls, err = ENOMEM;
+
+	if (!(re = calloc(1, sizeof(*re))))
+		return -1;
+
+	// The set of the forward program's leading loop, over any byte.
+	if (-1 == (any = newset(&ps)))
+		goto fail;
+	addrange(ps.sets[ps.nodes[any].arg], 0, 255);
+
+	if (-1 == (root = alternation(&ps)) || ps.p != ps.end) {
+		// A ')' without its '('.
+		err = ps.err ? ps.err : EINVAL;
+		goto fail;
+	}
+
+	re->sets = ps.sets;
+	re->nsets = ps.nsets;
+	re->ngroups = ps.ngroups;
+	ps.sets = NULL;
+
+	// Forward: a lazy loop over any byte, then the pattern.
+	g.nodes = ps.nodes;
+	g.prog = &re->fwdprog;
+	if (-1 == emit(&g, I_SPLIT, 3, 1) || -1 == emit(&g, I_SET, ps.nodes[any].arg, 0) ||
+	    -1 == emit(&g, I_JMP, 0, 0) || compile(&g, root) || -1 == emit(&g, I_MATCH, 0, 0))
+		goto genfail;
+	re->body = 3;
+
+	g.prog = &re->revprog;
+	g.rev = true;
+	if (compile(&g, root) || -1 == emit(&g, I_MATCH, 0, 0))
+		goto genfail;
+
+	// Each level of I_LOOP loops takes keys for every instruction.
+	if (keyof(&re->fwdprog, 0, re->fwdprog.depth + 1) > INSTS ||
+	    keyof(&re->revprog, 0, re->revprog.depth + 1) > INSTS) {
+		err = EINVAL;
+		goto fail;
+	}
+
+	if (prefix(re, ps.nodes, root))
+		goto fail;
+
+	ncls = byteclasses(re);
+
+	// Patterns starting with '^' only match at the start, skip the loop.
+	if (dfainit(re, &re->fwd, &re->fwdprog,
+	    N_CAT == ps.nodes[root].type && -1 != ps.nodes[root].child &&
+	    N_BEGIN == ps.nodes[ps.nodes[root].child].type ? re->body : 0, ncls, false) ||
+	    dfainit(re, &re->rev, &re->revprog, 0, ncls, true))
+		goto fail;
+
+	free(ps.nodes);
+	*rep = re;
+
+	return 0;
+
+genfail:
+	err = g.err;
+fail:
+	free(ps.nodes);
+	free(ps.sets);
+	stxrefree(re);
+	errno = err;
+
+	return -1;
+}
+
+int
+stxrefind(stxre *re, const spx text, spx *match, size_t nsub)
+{
+	size_t begin, end, i;
+
+	for (i=0; i<nsub; ++i)
+		match[i] = (spx){0};
+
+	// Literal patterns are searched for as they are.
+	if (re->literal) {
+		spx at = stxfind_spx(text, re->prefix);
+
+		if (!at.mem)
+			return 0;
+		if (nsub)
+			match[0] = at;
+		return 1;
+	}
+
+	if (findend(re, text, &end))
+		return -1;
+	if (NONE == end)
+		return 0;
+	if (findbegin(re, text, end, &begin))
+		return -1;
+
+	if (nsub > 1 && re->ngroups)
+		return submatches(re, text, begin, match, nsub);
+
+	if (nsub)
+		match[0] = stxslice(text, begin, end);
+
+	return 1;
+}
+
+size_t
+stxregroups(const stxre *re)
+{
+	return re->ngroups;
+}
+
+void
+stxrefree(stxre *re)
+{
+	if (!re)
+		return;
+
+	dfafree(&re->fwd);
+	dfafree(&re->rev);
+	free(re->fwdprog.insts);
+	free(re->revprog.insts);
+	free(re->sets);
+	free((char *)re->prefix.mem);
+	free(re);
+}
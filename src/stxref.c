@@ -1,9 +1,4 @@
 // See LICENSE file for copyright and license details
+// Defined in libstx.h, so LIBSTX_INLINE can inline it.
+#define LIBSTX_DEFINE_STXREF
 #include "internal.h"
-
-spx
-stxref(const stx *sp)
-{
-	spx tmp = {.mem = sp->mem, .len = sp->len};
-	return tmp;
-}
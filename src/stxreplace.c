@@ -0,0 +1,119 @@
+// See LICENSE file for copyright and license details
+#include "internal.h"
+
+// Offset of the first "from" in "ref" at or after "r", SIZE_MAX if there's none.
+static size_t
+findfrom(const spx ref, size_t r, const spx from)
+{
+	spx m = stxfind_spx(stxslice(ref, r, ref.len), from);
+
+	return m.mem ? (size_t)(m.mem - ref.mem) : SIZE_MAX;
+}
+
+int
+stxreplace(stx *sp, const spx from, const spx to, size_t max)
+{
+	spx ref = stxref(sp);
+	size_t r = 0;
+	size_t n = 0;
+	size_t at;
+
+	internal_stats_call(STXSTATS_REPLACE);
+
+	if (0 == from.len || 0 == max)
+		return 0;
+
+	// Shrinking replacements are done in place, the written part never gets
+	// ahead of the part still being searched.
+	if (to.len <= from.len) {
+		size_t w = 0;
+
+		while (n < max && SIZE_MAX != (at = findfrom(ref, r, from))) {
+			if (!n) {
+				if (internal_own(sp))
+					return -1;
+				ref = stxref(sp);
+			}
+
+			if (w != r)
+				internal_stats_move(at - r);
+			memmove(sp->mem + w, sp->mem + r, at - r);
+			w += at - r;
+			memcpy(sp->mem + w, to.mem, to.len);
+			w += to.len;
+			r = at + from.len;
+			++n;
+		}
+
+		if (n) {
+			if (w != r)
+				internal_stats_move(sp->len - r);
+			memmove(sp->mem + w, sp->mem + r, sp->len - r);
+			sp->len = w + sp->len - r;
+		}
+
+		return 0;
+	}
+
+	// Growing replacements need the exact length of the result first. The
+	// offsets of the matches are kept so the text is only searched once.
+	size_t local[64];
+	size_t *ats = local;
+	size_t cap = sizeof(local) / sizeof(*local);
+	size_t len = ref.len;
+	size_t grow = to.len - from.len;
+	size_t i;
+	stx dst;
+
+	while (n < max && SIZE_MAX != (at = findfrom(ref, r, from))) {
+		if (internal_size_add_overflows(len, grow))
+			goto fail;
+
+		if (n == cap) {
+			size_t *p = realloc(ats == local ? NULL : ats, 2 * cap * sizeof(*ats));
+
+			if (!p)
+				goto fail;
+			if (ats == local)
+				memcpy(p, local, sizeof(local));
+			ats = p;
+			cap *= 2;
+		}
+
+		len += grow;
+		ats[n++] = at;
+		r = at + from.len;
+	}
+
+	if (!n)
+		return 0;
+
+	if (stxalloc(&dst, len > sp->size ? len : sp->size))
+		goto fail;
+
+	for (r=0, i=0; i<n; ++i) {
+		at = ats[i];
+		memcpy(dst.mem + dst.len, ref.mem + r, at - r);
+		dst.len += at - r;
+		memcpy(dst.mem + dst.len, to.mem, to.len);
+		dst.len += to.len;
+		r = at + from.len;
+	}
+
+	memcpy(dst.mem + dst.len, ref.mem + r, ref.len - r);
+	dst.len += ref.len - r;
+
+	if (ats != local)
+		free(ats);
+
+	// Also drops the reference to shared memory instead of freeing it.
+	stxfree(sp);
+	*sp = dst;
+
+	return 0;
+
+fail:
+	if (ats != local)
+		free(ats);
+	return -1;
+}
@@ -0,0 +1,64 @@
+// See LICENSE file for copyright and license details
+#include "internal.h"
+
+int
+stxshare(stx *sp, stx *src)
+{
+	// Empty memory has nothing worth sharing.
+	if (src->mem && !src->rc) {
+		if (!(src->rc = malloc(sizeof(*src->rc))))
+			return -1;
+
+		atomic_init(&src->rc->refs, 1);
+	}
+
+	if (src->rc)
+		atomic_fetch_add_explicit(&src->rc->refs, 1, memory_order_relaxed);
+
+	*sp = *src;
+
+	return 0;
+}
+
+int
+stxunshare(stx *sp)
+{
+	char *mem;
+
+	internal_stats_call(STXSTATS_UNSHARE);
+
+	if (!sp->rc)
+		return 0;
+
+	// The last reference takes the memory over without copying it.
+	if (1 == atomic_load_explicit(&sp->rc->refs, memory_order_acquire)) {
+		free(sp->rc);
+		sp->rc = NULL;
+		return 0;
+	}
+
+	// Nothing to copy, and malloc(0) may return NULL.
+	if (0 == sp->size) {
+		stxfree(sp);
+		sp->mem = NULL;
+		sp->len = 0;
+		sp->rc = NULL;
+		return 0;
+	}
+
+	if (!(mem = malloc(sp->size)))
+		return -1;
+
+	internal_stats_alloc(sp->size);
+
+	memcpy(mem, sp->mem, sp->len);
+
+	// Drop the reference, which also frees the memory if every other
+	// reference went away in the meantime.
+	stxfree(sp);
+
+	sp->mem = mem;
+	sp->rc = NULL;
+
+	return 0;
+}
@@ -1,13 +1,4 @@
 // See LICENSE file for copyright and license details
+// Defined in libstx.h, so LIBSTX_INLINE can inline it.
+#define LIBSTX_DEFINE_STXSLICE
 #include "internal.h"
-
-spx
-stxslice(const spx src, size_t begin, size_t end)
-{
-	spx slice = {
-		.mem = src.mem + begin,
-		.len = end - begin
-	};
-
-	return slice;
-}
@@ -0,0 +1,155 @@
+// See LICENSE file for copyright and license details
+#include "internal.h"
+
+#ifdef LIBSTX_STATS
+#include <pthread.h>
+
+#define COUNTERS (sizeof(struct stxstats) / sizeof(uint64_t))
+
+/**
+ * Counters of a single thread. Only their thread writes to them, so they are
+ * updated without atomic read-modify-writes, and only read by snapshots.
+ */
+struct record {
+	atomic_uint_least64_t counters[COUNTERS];
+	struct record *next;
+	struct record **prev;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_key_t key;
+// Records of live threads, and the sum of those of exited threads.
+static struct record *records;
+static uint64_t retired[COUNTERS];
+static _Thread_local struct record *local;
+// Set once the record of the thread is folded, calls made later on its way out,
+// from other destructors, go uncounted.
+static _Thread_local bool detached;
+
+static void
+detach(void *arg)
+{
+	struct record *rec = arg;
+	size_t i;
+
+	pthread_mutex_lock(&lock);
+	for (i=0; i<COUNTERS; ++i)
+		retired[i] += atomic_load_explicit(rec->counters + i, memory_order_relaxed);
+	if (rec->next)
+		rec->next->prev = rec->prev;
+	*rec->prev = rec->next;
+	pthread_mutex_unlock(&lock);
+
+	free(rec);
+	local = NULL;
+	detached = true;
+}
+
+static void
+init(void)
+{
+	pthread_key_create(&key, detach);
+}
+
+static struct record *
+attach(void)
+{
+	struct record *rec;
+	size_t i;
+
+	pthread_once(&once, init);
+
+	// Without a record the thread goes uncounted.
+	if (!(rec = malloc(sizeof(*rec))))
+		return NULL;
+
+	for (i=0; i<COUNTERS; ++i)
+		atomic_init(rec->counters + i, 0);
+
+	pthread_mutex_lock(&lock);
+	rec->next = records;
+	rec->prev = &records;
+	if (records)
+		records->prev = &rec->next;
+	records = rec;
+	pthread_mutex_unlock(&lock);
+
+	// Folds the record into the retired counters when the thread exits.
+	pthread_setspecific(key, rec);
+
+	return rec;
+}
+
+static void
+add(size_t i, uint64_t n)
+{
+	atomic_uint_least64_t *c;
+
+	if (!local && (detached || !(local = attach())))
+		return;
+
+	c = local->counters + i;
+	atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n,
+		memory_order_relaxed);
+}
+
+#define INDEX(field) (offsetof(struct stxstats, field) / sizeof(uint64_t))
+
+void
+internal_stats_call(int fn)
+{
+	add(INDEX(calls) + fn, 1);
+}
+
+void
+internal_stats_alloc(size_t n)
+{
+	add(INDEX(allocs), 1);
+	add(INDEX(alloc_bytes), n);
+}
+
+void
+internal_stats_realloc(size_t size, size_t growth)
+{
+	add(INDEX(reallocs), 1);
+	add(INDEX(realloc_bytes), size);
+	if (growth)
+		add(INDEX(growth) + 63 - internal_clz64(growth), 1);
+}
+
+void
+internal_stats_move(size_t n)
+{
+	add(INDEX(moves), 1);
+	add(INDEX(move_bytes), n);
+}
+
+int
+stxstats_snapshot(struct stxstats *st)
+{
+	uint64_t sum[COUNTERS];
+	struct record *rec;
+	size_t i;
+
+	pthread_mutex_lock(&lock);
+	memcpy(sum, retired, sizeof(sum));
+	for (rec=records; rec; rec=rec->next) {
+		for (i=0; i<COUNTERS; ++i)
+			sum[i] += atomic_load_explicit(rec->counters + i, memory_order_relaxed);
+	}
+	pthread_mutex_unlock(&lock);
+
+	memcpy(st, sum, sizeof(*st));
+
+	return 0;
+}
+#else
+int
+stxstats_snapshot(struct stxstats *st)
+{
+	memset(st, 0, sizeof(*st));
+
+	return -1;
+}
+#endif
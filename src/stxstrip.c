@@ -4,17 +4,19 @@
 stx *
 stxlstrip(stx *s1, const char *chs, size_t len)
 {
-	size_t removed = 0;
-	char *begin = s1->mem;
-	char *end = s1->mem + s1->len;
+	size_t removed;
 
-	while (begin != end && memchr(chs, *begin, len)) {
-		++removed;
-		++begin;
-	}
+	internal_stats_call(STXSTATS_LSTRIP);
+
+	removed = internal_kern->span(s1->mem, s1->len, chs, len);
 
-	if (begin != s1->mem)
-		memmove(s1->mem, begin, s1->len - removed);
+	if (removed) {
+		if (internal_own(s1))
+			return s1;
+
+		internal_stats_move(s1->len - removed);
+		memmove(s1->mem, s1->mem + removed, s1->len - removed);
+	}
 
 	s1->len -= removed;
 	return s1;
@@ -23,19 +25,7 @@ stxlstrip(stx *s1, const char *chs, size_t len)
 stx *
 stxrstrip(stx *s1, const char *chs, size_t len)
 {
-	if (0 == s1->len)
-		return s1;
-
-	size_t removed = 0;
-	char *begin = s1->mem + s1->len - 1;
-	char *end = s1->mem;
-
-	while (begin != end && memchr(chs, *begin, len)) {
-		++removed;
-		--begin;
-	}
-
-	s1->len -= removed;
+	s1->len -= internal_kern->rspan(s1->mem, s1->len, chs, len);
 	return s1;
 }
 
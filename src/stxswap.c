@@ -1,10 +1,4 @@
 // See LICENSE file for copyright and license details
+// Defined in libstx.h, so LIBSTX_INLINE can inline it.
+#define LIBSTX_DEFINE_STXSWAP
 #include "internal.h"
-
-void
-stxswap(stx *s1, stx *s2)
-{
-	stx tmp = *s1;
-	*s1 = *s2;
-	*s2 = tmp;
-}
@@ -1,10 +1,4 @@
+// See LICENSE file for copyright and license details
+// Defined in libstx.h, so LIBSTX_INLINE can inline it.
+#define LIBSTX_DEFINE_STXTERM
 #include "internal.h"
-
-stx *
-stxterm(stx *sp)
-{
-	if (sp->len < sp->size)
-		sp->mem[sp->len] = '\0';
-
-	return sp;
-}
@@ -1,14 +1,4 @@
 // See LICENSE file for copyright and license details
+// Defined in libstx.h, so LIBSTX_INLINE can inline it.
+#define LIBSTX_DEFINE_STXTRUNC
 #include "internal.h"
-
-stx *
-stxtrunc(stx *sp, size_t len)
-{
-	if (len >= sp->len) {
-		sp->len = 0;
-		return sp;
-	}
-
-	sp->len -= len;
-	return sp;
-}
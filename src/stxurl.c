@@ -0,0 +1,161 @@
+// See LICENSE file for copyright and license details
+#include <errno.h>
+
+#include "internal.h"
+
+// Length of the encoded "src", or SIZE_MAX if it overflows.
+static size_t
+encodedlen(const spx src, int flags)
+{
+	size_t len = src.len;
+	size_t i = 0;
+
+	while ((i += internal_kern->urlenc(src.mem + i, src.len - i)) < src.len) {
+		if (!(flags & STXURL_PLUS && ' ' == src.mem[i])) {
+			if (internal_size_add_overflows(len, 2))
+				return SIZE_MAX;
+			len += 2;
+		}
+		++i;
+	}
+
+	return len;
+}
+
+// Bytes other than letters, digits and "-._~" are encoded, and the runs between
+// them copied whole. The encoded bytes are counted first, so the stx grows at
+// most once.
+int
+stxapp_urlenc(stx *sp, const spx src, int flags)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	size_t len = encodedlen(src, flags);
+	size_t i = 0;
+	size_t run;
+	char *dst;
+
+	if (SIZE_MAX == len || internal_size_add_overflows(sp->len, len))
+		return -1;
+
+	if (stxensuresize(sp, sp->len + len) || internal_own(sp))
+		return -1;
+
+	dst = sp->mem + sp->len;
+
+	while (i < src.len) {
+		unsigned char c;
+
+		run = internal_kern->urlenc(src.mem + i, src.len - i);
+		memcpy(dst, src.mem + i, run);
+		dst += run;
+		if ((i += run) == src.len)
+			break;
+
+		c = src.mem[i++];
+		if (flags & STXURL_PLUS && ' ' == c) {
+			*dst++ = '+';
+		} else {
+			dst[0] = '%';
+			dst[1] = hex[c >> 4];
+			dst[2] = hex[c & 0xF];
+			dst += 3;
+		}
+	}
+
+	sp->len += len;
+
+	return 0;
+}
+
+static int
+hexval(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+// Decoded strings are never longer, so the stx grows at most once. Nothing is
+// appended if a '%' isn't followed by two hex digits.
+int
+stxapp_urldec(stx *sp, const spx src, int flags)
+{
+	// Without STXURL_PLUS, only '%' is looked for.
+	unsigned char plus = flags & STXURL_PLUS ? '+' : '%';
+	size_t i = 0;
+	size_t run;
+	char *dst;
+	int hi, lo;
+
+	if (internal_size_add_overflows(sp->len, src.len))
+		return -1;
+
+	if (stxensuresize(sp, sp->len + src.len) || internal_own(sp))
+		return -1;
+
+	dst = sp->mem + sp->len;
+
+	while (i < src.len) {
+		run = internal_kern->chr2(src.mem + i, src.len - i, '%', plus);
+		memcpy(dst, src.mem + i, run);
+		dst += run;
+		if ((i += run) == src.len)
+			break;
+
+		if ('+' == src.mem[i]) {
+			*dst++ = ' ';
+			++i;
+			continue;
+		}
+
+		if (src.len - i < 3 || -1 == (hi = hexval(src.mem[i + 1])) ||
+		    -1 == (lo = hexval(src.mem[i + 2]))) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		*dst++ = hi << 4 | lo;
+		i += 3;
+	}
+
+	sp->len = dst - sp->mem;
+
+	return 0;
+}
+
+// Pairs are separated by '&' and split at their first '='. Empty pairs are
+// skipped, and a pair without '=' has an empty value at its end.
+size_t
+stxquery(const spx query, stxkv *kvs, size_t n)
+{
+	const char *p = query.mem, *end = p + query.len;
+	size_t count = 0;
+
+	while (p < end) {
+		const char *amp = memchr(p, '&', end - p);
+		spx pair = {.mem = p, .len = (amp ? amp : end) - p};
+		const char *eq;
+		size_t klen;
+		stxkv *kv;
+
+		p += pair.len + 1;
+		if (!pair.len)
+			continue;
+
+		if (count++ >= n)
+			continue;
+
+		kv = kvs + count - 1;
+		eq = memchr(pair.mem, '=', pair.len);
+		klen = eq ? (size_t)(eq - pair.mem) : pair.len;
+		kv->key = stxslice(pair, 0, klen);
+		kv->val = stxslice(pair, eq ? klen + 1 : klen, pair.len);
+		kv->enc = internal_kern->chr2(pair.mem, pair.len, '%', '+') < pair.len;
+	}
+
+	return count;
+}
@@ -9,28 +9,74 @@ enum {
 	UTF8_HC = 0x02 << 6, // Continuation byte header 10xxxxxx.
 };
 
+// Count the bytes starting an encoding, which is every byte but continuation
+// bytes, so a valid encoding is counted once whatever its length.
 size_t
 stxutf8len(const spx sp)
 {
-	size_t n = 0;
+	return internal_kern->utf8len(sp.mem, sp.len);
+}
+
+// Valid encodings are the well-formed byte sequences of the Unicode standard:
+// no overlong encodings, surrogates, or code points past 0x10FFFF.
+bool
+stxutf8valid(const spx sp)
+{
+	const unsigned char *mem = (const unsigned char *)sp.mem;
 	size_t i = 0;
+	size_t need, j;
+	unsigned char lo, hi;
+	uint64_t w;
+
 	while (i < sp.len) {
-		if (sp.mem[i] & UTF8_H1) {
-			i += 1;
-		} else if (sp.mem[i] & UTF8_H2) {
-			i += 2;
-		} else if (sp.mem[i] & UTF8_H3) {
-			i += 3;
-		} else if (sp.mem[i] & UTF8_H4) {
-			i += 4;
+		// Skip ASCII 8 bytes at a time.
+		if (i + 8 <= sp.len) {
+			memcpy(&w, mem + i, 8);
+			if (!(w & UINT64_C(0x8080808080808080))) {
+				i += 8;
+				continue;
+			}
+		}
+
+		if (mem[i] < 0x80) {
+			++i;
+			continue;
+		}
+
+		// The range of the second byte depends on the first one.
+		lo = 0x80;
+		hi = 0xBF;
+		if (mem[i] >= 0xC2 && mem[i] <= 0xDF) {
+			need = 1;
+		} else if (mem[i] >= 0xE0 && mem[i] <= 0xEF) {
+			need = 2;
+			if (0xE0 == mem[i])
+				lo = 0xA0;
+			else if (0xED == mem[i])
+				hi = 0x9F;
+		} else if (mem[i] >= 0xF0 && mem[i] <= 0xF4) {
+			need = 3;
+			if (0xF0 == mem[i])
+				lo = 0x90;
+			else if (0xF4 == mem[i])
+				hi = 0x8F;
 		} else {
-			// Error condition.
-			return 0;
+			return false;
+		}
+
+		if (sp.len - i <= need)
+			return false;
+		if (mem[i + 1] < lo || mem[i + 1] > hi)
+			return false;
+		for (j=2; j<=need; ++j) {
+			if (0x80 != (mem[i + j] & 0xC0))
+				return false;
 		}
-		++n;
+
+		i += need + 1;
 	}
 
-	return n;
+	return true;
 }
 
 size_t
@@ -43,7 +89,7 @@ stxutf8n32(uint32_t wc)
 		len = 2;
 	} else if (wc < 0x10000) {
 		len = 3;
-	} else if (wc < 0x11000) {
+	} else if (wc < 0x110000) {
 		len = 4;
 	} else {
 		// Error case.
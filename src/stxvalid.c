@@ -1,13 +1,4 @@
 // See LICENSE file for copyright and license details
+// Defined in libstx.h, so LIBSTX_INLINE can inline it.
+#define LIBSTX_DEFINE_STXVALID
 #include "internal.h"
-
-bool
-stxvalid(stx *s1)
-{
-	if (!s1)
-		return false;
-	if (!s1->mem || s1->size < s1->len)
-		return false;
-
-	return true;
-}
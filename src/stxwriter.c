@@ -0,0 +1,328 @@
+// See LICENSE file for copyright and license details
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+/**
+ * Buffers form a ring, the "count" buffers starting at "head" are full and
+ * queued for the background thread, in order. The buffer right after them is
+ * the active one producers append to.
+ */
+struct stxwriter {
+	pthread_mutex_t mu;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+	pthread_t th;
+	int fd;
+	stxwriteropts opts;
+	stx *bufs;
+	size_t head;
+	size_t count;
+	// Number of buffers queued and written since the start.
+	uint64_t queued;
+	uint64_t written;
+	// When the active buffer got its first bytes, and whether it did.
+	struct timespec since;
+	bool fresh;
+	bool stop;
+	int err;
+};
+
+static stx *
+active(stxwriter *w)
+{
+	return w->bufs + (w->head + w->count) % w->opts.nbufs;
+}
+
+// Queue the active buffer, if there is a free buffer to take its place.
+static bool
+rotate(stxwriter *w)
+{
+	if (w->count + 1 == w->opts.nbufs)
+		return false;
+
+	++w->count;
+	++w->queued;
+	pthread_cond_signal(&w->wake);
+
+	return true;
+}
+
+static int
+writeall(int fd, const char *mem, size_t len)
+{
+	while (len) {
+		ssize_t n = write(fd, mem, len);
+
+		if (-1 == n) {
+			if (EINTR == errno)
+				continue;
+			return -1;
+		}
+
+		mem += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static bool
+expired(stxwriter *w)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec > w->since.tv_sec
+		|| (now.tv_sec == w->since.tv_sec && now.tv_nsec >= w->since.tv_nsec);
+}
+
+static void *
+flusher(void *arg)
+{
+	stxwriter *w = arg;
+
+	pthread_mutex_lock(&w->mu);
+
+	for (;;) {
+		stx *buf;
+		int err = 0;
+
+		while (0 == w->count) {
+			stx *act = active(w);
+
+			// Whatever is left is written before stopping.
+			if (w->stop) {
+				if (0 == act->len || !rotate(w))
+					goto out;
+				continue;
+			}
+
+			// The threshold might have been reached while every buffer
+			// was queued.
+			if (act->len >= w->opts.threshold) {
+				rotate(w);
+			} else if (!w->opts.interval || 0 == act->len) {
+				pthread_cond_wait(&w->wake, &w->mu);
+			} else if (expired(w)) {
+				rotate(w);
+			} else {
+				pthread_cond_timedwait(&w->wake, &w->mu, &w->since);
+			}
+		}
+
+		buf = w->bufs + w->head;
+
+		// Producers only touch the active buffer, write this one unlocked.
+		pthread_mutex_unlock(&w->mu);
+		if (writeall(w->fd, buf->mem, buf->len))
+			err = errno;
+		else if (STXSYNC_EACH == w->opts.sync && fdatasync(w->fd))
+			err = errno;
+		pthread_mutex_lock(&w->mu);
+
+		if (err && !w->err)
+			w->err = err;
+
+		buf->len = 0;
+		w->head = (w->head + 1) % w->opts.nbufs;
+		--w->count;
+		++w->written;
+		pthread_cond_broadcast(&w->done);
+	}
+
+out:
+	pthread_mutex_unlock(&w->mu);
+
+	return NULL;
+}
+
+int
+stxwriteropen(stxwriter **wp, int fd, const stxwriteropts *opts)
+{
+	stxwriteropts def = {0};
+	pthread_condattr_t attr;
+	stxwriter *w;
+	size_t i;
+
+	if (opts)
+		def = *opts;
+	if (!def.size)
+		def.size = 65536;
+	if (def.nbufs < 2)
+		def.nbufs = 2;
+	if (!def.threshold || def.threshold > def.size)
+		def.threshold = def.size;
+
+	if (!(w = calloc(1, sizeof(*w))))
+		return -1;
+
+	if (!(w->bufs = calloc(def.nbufs, sizeof(*w->bufs))))
+		goto fail;
+
+	for (i=0; i<def.nbufs; ++i) {
+		if (stxalloc(w->bufs + i, def.size))
+			goto fail;
+	}
+
+	w->fd = fd;
+	w->opts = def;
+
+	// Time limits are measured on a clock that isn't changed by hand.
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&w->mu, NULL);
+	pthread_cond_init(&w->wake, &attr);
+	pthread_cond_init(&w->done, NULL);
+	pthread_condattr_destroy(&attr);
+
+	if ((errno = pthread_create(&w->th, NULL, flusher, w))) {
+		pthread_cond_destroy(&w->done);
+		pthread_cond_destroy(&w->wake);
+		pthread_mutex_destroy(&w->mu);
+		goto fail;
+	}
+
+	*wp = w;
+
+	return 0;
+
+fail:
+	if (w->bufs) {
+		for (i=0; i<def.nbufs; ++i)
+			stxfree(w->bufs + i);
+		free(w->bufs);
+	}
+	free(w);
+
+	return -1;
+}
+
+stx *
+stxwriterget(stxwriter *w, size_t n)
+{
+	stx *act;
+
+	pthread_mutex_lock(&w->mu);
+
+	// Queue the active buffer when "n" doesn't fit, and wait for a buffer to
+	// be written when there is none left.
+	while ((act = active(w))->len && stxavail(act) < n) {
+		if (!rotate(w))
+			pthread_cond_wait(&w->done, &w->mu);
+	}
+
+	if (0 == act->len) {
+		// Messages larger than a buffer get a buffer of their own.
+		if (stxensuresize(act, n)) {
+			pthread_mutex_unlock(&w->mu);
+			return NULL;
+		}
+
+		w->fresh = true;
+	}
+
+	return act;
+}
+
+void
+stxwriterput(stxwriter *w)
+{
+	stx *act = active(w);
+
+	if (act->len >= w->opts.threshold) {
+		rotate(w);
+	} else if (w->fresh && act->len && w->opts.interval) {
+		// Start the time limit of the buffer.
+		clock_gettime(CLOCK_MONOTONIC, &w->since);
+		w->since.tv_sec += w->opts.interval / 1000;
+		w->since.tv_nsec += w->opts.interval % 1000 * 1000000;
+		if (w->since.tv_nsec >= 1000000000) {
+			++w->since.tv_sec;
+			w->since.tv_nsec -= 1000000000;
+		}
+
+		pthread_cond_signal(&w->wake);
+	}
+
+	if (act->len)
+		w->fresh = false;
+
+	pthread_mutex_unlock(&w->mu);
+}
+
+int
+stxwriterflush(stxwriter *w)
+{
+	uint64_t target;
+	int sync, fd;
+	int err = 0;
+
+	pthread_mutex_lock(&w->mu);
+
+	while (active(w)->len && !rotate(w))
+		pthread_cond_wait(&w->done, &w->mu);
+
+	target = w->queued;
+	while (w->written < target)
+		pthread_cond_wait(&w->done, &w->mu);
+
+	sync = w->opts.sync;
+	fd = w->fd;
+	pthread_mutex_unlock(&w->mu);
+
+	// Producers and the thread go on while the data reaches the disk.
+	if (STXSYNC_NONE != sync && fdatasync(fd))
+		err = errno;
+
+	pthread_mutex_lock(&w->mu);
+	if (err && !w->err)
+		w->err = err;
+	err = w->err;
+	pthread_mutex_unlock(&w->mu);
+
+	if (err) {
+		errno = err;
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+stxwriterclose(stxwriter *w)
+{
+	size_t i;
+	int err;
+
+	pthread_mutex_lock(&w->mu);
+	w->stop = true;
+	pthread_cond_signal(&w->wake);
+	pthread_mutex_unlock(&w->mu);
+
+	pthread_join(w->th, NULL);
+
+	err = w->err;
+	if (STXSYNC_NONE != w->opts.sync && fdatasync(w->fd) && !err)
+		err = errno;
+
+	for (i=0; i<w->opts.nbufs; ++i)
+		stxfree(w->bufs + i);
+	free(w->bufs);
+	pthread_cond_destroy(&w->done);
+	pthread_cond_destroy(&w->wake);
+	pthread_mutex_destroy(&w->mu);
+	free(w);
+
+	if (err) {
+		errno = err;
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+// See LICENSE file for copyright and license details
+#define _XOPEN_SOURCE 700
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "internal.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+
+// Parts up to SMALL bytes are copied into a staging buffer, runs of them are
+// then written as a single iovec.
+#define SMALL 128
+#define STAGE 4096
+#define BATCH (IOV_MAX < 1024 ? IOV_MAX : 1024)
+
+static int
+writeall(int fd, struct iovec *iov, int cnt)
+{
+	ssize_t n;
+
+	while (cnt) {
+		do {
+			n = writev(fd, iov, cnt);
+		} while (-1 == n && EINTR == errno);
+
+		if (-1 == n)
+			return -1;
+
+		// Skip what was written, and resume partial writes where they stopped.
+		for (; cnt && (size_t)n >= iov->iov_len; ++iov, --cnt)
+			n -= iov->iov_len;
+
+		if (cnt) {
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	return 0;
+}
+
+int
+stxwritev(int fd, const spx *parts, size_t n)
+{
+	struct iovec iov[BATCH];
+	char stage[STAGE];
+	size_t i = 0;
+
+	while (i < n) {
+		bool staged = false;
+		size_t used = 0;
+		int cnt = 0;
+
+		for (; i < n && cnt < BATCH; ++i) {
+			const spx *p = parts + i;
+
+			if (0 == p->len)
+				continue;
+
+			if (p->len <= SMALL && used + p->len <= STAGE) {
+				memcpy(stage + used, p->mem, p->len);
+
+				if (staged) {
+					iov[cnt - 1].iov_len += p->len;
+				} else {
+					iov[cnt].iov_base = stage + used;
+					iov[cnt++].iov_len = p->len;
+					staged = true;
+				}
+
+				used += p->len;
+			} else {
+				iov[cnt].iov_base = (void *)p->mem;
+				iov[cnt++].iov_len = p->len;
+				staged = false;
+			}
+		}
+
+		if (writeall(fd, iov, cnt))
+			return -1;
+	}
+
+	return 0;
+}
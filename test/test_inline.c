@@ -0,0 +1,69 @@
+#define LIBSTX_INLINE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+// Every function is used through its inline definition, the archive versions
+// are tested by their own tests.
+TEST_DEFINE(inline_accessors)
+{
+	stx s1;
+	stx s2;
+	spx sp;
+
+	stxdup_str(&s1, "inline");
+	stxalloc(&s2, 4);
+
+	TEST_ASSERT(stxvalid(&s1));
+	TEST_ASSERT(!stxvalid(NULL));
+	TEST_ASSERT(0 == stxavail(&s1));
+	TEST_ASSERT(4 == stxavail(&s2));
+
+	sp = stxref(&s1);
+	TEST_ASSERT(s1.mem == sp.mem && 6 == sp.len);
+	sp = stxslice(sp, 2, 4);
+	TEST_ASSERT(s1.mem + 2 == sp.mem && 2 == sp.len);
+
+	stxswap(&s1, &s2);
+	TEST_ASSERT(6 == s2.len && 0 == s1.len);
+	TEST_ASSERT(4 == stxtrunc(&s2, 2)->len);
+	TEST_ASSERT('\0' == stxterm(&s2)->mem[4]);
+
+	stxfree(&s1);
+	stxfree(&s2);
+
+	TEST_END;
+}
+
+TEST_DEFINE(inline_shared)
+{
+	stx s1;
+	stx s2;
+
+	stxdup_str(&s1, "shared");
+	stxtrunc(&s1, 1);
+	stxshare(&s2, &s1);
+
+	// Terminating writes, so it unshares first.
+	stxterm(&s2);
+	TEST_ASSERT(s1.mem != s2.mem);
+	TEST_ASSERT('d' == s1.mem[5]);
+	TEST_ASSERT('\0' == s2.mem[5]);
+
+	stxfree(&s1);
+	stxfree(&s2);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	TEST_INIT(ts);
+	TEST_RUN(ts, inline_accessors);
+	TEST_RUN(ts, inline_shared);
+	TEST_PRINT(ts);
+}
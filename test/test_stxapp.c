@@ -138,6 +138,189 @@ TEST_DEFINE(stxapp_str_twice)
 	TEST_END;
 }
 
+TEST_DEFINE(stxappf_fits)
+{
+	stx s1;
+	char *p;
+
+	stxalloc(&s1, 64);
+	p = s1.mem;
+
+	TEST_ASSERT(0 == stxappf(&s1, "%s=%d", "key", 42));
+	TEST_ASSERT(0 == stxappf(&s1, ",%u", 7u));
+	TEST_ASSERT(p == s1.mem);
+	TEST_ASSERT(8 == s1.len);
+	TEST_ASSERT(64 == s1.size);
+	TEST_ASSERT(0 == memcmp(s1.mem, "key=42,7", 8));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+static int
+precision(int n, const char *mem)
+{
+	(void)mem;
+	return n;
+}
+
+TEST_DEFINE(stxappf_stxarg_limit)
+{
+	spx ref = {.mem = rs1, .len = INT_MAX};
+
+	// Only the length is used, nothing is read.
+	TEST_ASSERT(INT_MAX == precision(STXARG(ref)));
+
+	if (SIZE_MAX > INT_MAX) {
+		ref.len = (size_t)INT_MAX + 6;
+		TEST_ASSERT(INT_MAX == precision(STXARG(ref)));
+		ref.len = SIZE_MAX;
+		TEST_ASSERT(INT_MAX == precision(STXARG(ref)));
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxappf_grow)
+{
+	stx s1 = {0};
+	spx ref = {.mem = rs1, .len = strlen(rs1)};
+
+	TEST_ASSERT(0 == stxappf(&s1, "<" STXFMT ">", STXARG(ref)));
+	TEST_ASSERT(strlen(rs1) + 2 == s1.len);
+	TEST_ASSERT(s1.len < s1.size);
+	TEST_ASSERT('\0' == s1.mem[s1.len]);
+	TEST_ASSERT('<' == s1.mem[0]);
+	TEST_ASSERT(0 == memcmp(s1.mem + 1, rs1, strlen(rs1)));
+	TEST_ASSERT('>' == s1.mem[s1.len - 1]);
+
+	TEST_ASSERT(0 == stxappf(&s1, "%s", ""));
+	TEST_ASSERT(strlen(rs1) + 2 == s1.len);
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxappf_ints)
+{
+	static const char *flags[] = {"", "-", "+", " ", "#", "0", "-+", "+0", "# ", "-#0"};
+	static const char *convs = "diuoxX";
+	char fmt[32], want[128];
+	stx s1 = {0};
+
+	for (int i = 0; i < 2000; ++i) {
+		long long v = (long long)((unsigned long long)rand() << 40 ^ (unsigned long long)rand() << 20 ^ rand());
+		char *p = fmt;
+		int n;
+
+		v >>= rand() % 64;
+		if (rand() % 2)
+			v = -v;
+		if (!(rand() % 8))
+			v = 0;
+
+		p += sprintf(p, "<%%%s", flags[rand() % 10]);
+		if (rand() % 2)
+			p += sprintf(p, "%d", rand() % 30);
+		if (rand() % 2)
+			p += sprintf(p, ".%d", rand() % 25);
+		sprintf(p, "ll%c>", convs[rand() % 6]);
+
+		n = snprintf(want, sizeof(want), fmt, v);
+		s1.len = 0;
+		TEST_ASSERT(0 == stxappf(&s1, fmt, v));
+		TEST_ASSERT((size_t)n == s1.len);
+		TEST_ASSERT(0 == memcmp(s1.mem, want, n + 1));
+	}
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxappf_convs)
+{
+	char want[512];
+	stx s1 = {0};
+	int n1, n2, n;
+	short h;
+
+#define CHECK(...) do { \
+		n = snprintf(want, sizeof(want), __VA_ARGS__); \
+		s1.len = 0; \
+		TEST_ASSERT(0 == stxappf(&s1, __VA_ARGS__)); \
+		TEST_ASSERT((size_t)n == s1.len); \
+		TEST_ASSERT(0 == memcmp(s1.mem, want, n + 1)); \
+	} while (0)
+
+	CHECK("%hhd %hhu %hd %hu %d %u", 300, 300, 70000, 70000, INT_MIN, UINT_MAX);
+	CHECK("%ld %lu %jd %ju %zu %zx %td", LONG_MIN, ULONG_MAX, INTMAX_MIN, UINTMAX_MAX, SIZE_MAX, (size_t)0xabc, (ptrdiff_t)-5);
+	CHECK("%*d|%-*d|%.*d|%*.*x", 6, 42, -6, 42, 4, 42, -8, -1, 255u);
+	CHECK("%.0d|%.0o|%#.0o|%#x|%#o|%+.0d|% d", 0, 0u, 0u, 0u, 8u, 0, 0);
+	CHECK("%c|%5c|%-3c|%%", 'a', 'b', 'c');
+	CHECK("%s|%8s|%-8s|%.2s|%.*s|%.10s", "abc", "abc", "abc", "abc", 1, "abc", "abc");
+	CHECK("%f|%.3e|%g|%10.2f|%-+8.1f|%a|%G", 3.25, 12345.678, 1e-5, -2.5, 1.0, 0.5, 1e100);
+	CHECK("%Lf|%p|%ls", (long double)1.5, (void *)&s1, L"wide");
+	CHECK("%e", 1e308);
+	CHECK("%.300f", 1.0);
+
+	s1.len = 0;
+	TEST_ASSERT(0 == stxappf(&s1, "ab%ncd%hn", &n1, &h));
+	TEST_ASSERT(2 == n1);
+	TEST_ASSERT(4 == h);
+
+	// Counted from where the call started.
+	TEST_ASSERT(0 == stxappf(&s1, "x%n", &n2));
+	TEST_ASSERT(1 == n2);
+
+	TEST_ASSERT(-1 == stxappf(&s1, "%k"));
+	TEST_ASSERT(-1 == stxappf(&s1, "abc%"));
+	TEST_ASSERT(5 == s1.len);
+
+#undef CHECK
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxappf_spx)
+{
+	spx ref = {.mem = "a\0b", .len = 3};
+	stx s1 = {0};
+
+	// "%v" appends every byte of a spx, unlike STXFMT which stops at a null.
+	TEST_ASSERT(0 == stxappf(&s1, "<%v|" STXFMT "|%5v|%-4v|%.1v>", ref, STXARG(ref), ref, ref, ref));
+	TEST_ASSERT(20 == s1.len);
+	TEST_ASSERT(0 == memcmp(s1.mem, "<a\0b|a|  a\0b|a\0b |a>", 20));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxappf_alias)
+{
+	stx s1;
+
+	stxalloc(&s1, 4);
+	stxcpy_str(&s1, "abcd");
+
+	// Appending a stx to itself keeps working when growing moves it.
+	for (int i = 0; i < 8; ++i)
+		TEST_ASSERT(0 == stxappf(&s1, STXFMT "%v", STXARG(stxref(&s1)), stxref(&s1)));
+
+	TEST_ASSERT(4 * 6561 == s1.len);
+	for (size_t i = 0; i < s1.len; i += 4)
+		TEST_ASSERT(0 == memcmp(s1.mem + i, "abcd", 4));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
 int
 main(void)
 {
@@ -155,5 +338,12 @@ main(void)
 	TEST_RUN(ts, stxapp_str_zero);
 	TEST_RUN(ts, stxapp_str_once);
 	TEST_RUN(ts, stxapp_str_twice);
+	TEST_RUN(ts, stxappf_fits);
+	TEST_RUN(ts, stxappf_stxarg_limit);
+	TEST_RUN(ts, stxappf_grow);
+	TEST_RUN(ts, stxappf_ints);
+	TEST_RUN(ts, stxappf_convs);
+	TEST_RUN(ts, stxappf_spx);
+	TEST_RUN(ts, stxappf_alias);
 	TEST_PRINT(ts);
 }
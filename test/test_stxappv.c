@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include "../libstx.h"
+#include "test.h"
+
+// Random bytes generated for the test.
+char rb1[1024];
+char rb2[1024];
+char rb3[1024];
+
+TEST_DEFINE(stxappv_zero)
+{
+	stx s1 = {0};
+
+	TEST_ASSERT(0 == stxappv(&s1, NULL, 0));
+	TEST_ASSERT(NULL == s1.mem);
+	TEST_ASSERT(0 == s1.len);
+	TEST_ASSERT(0 == s1.size);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxappv_segments)
+{
+	stx s1;
+	const spx segs[] = {
+		{.mem = rb1, .len = sizeof(rb1)},
+		{.mem = rb2, .len = 0},
+		{.mem = rb3, .len = sizeof(rb3)},
+	};
+
+	stxalloc(&s1, 1);
+	stxapp_mem(&s1, rb2, 1);
+
+	TEST_ASSERT(0 == stxappv(&s1, segs, 3));
+	TEST_ASSERT(1 + sizeof(rb1) + sizeof(rb3) == s1.len);
+	TEST_ASSERT(s1.len == s1.size);
+	TEST_ASSERT(rb2[0] == s1.mem[0]);
+	TEST_ASSERT(0 == memcmp(s1.mem + 1, rb1, sizeof(rb1)));
+	TEST_ASSERT(0 == memcmp(s1.mem + 1 + sizeof(rb1), rb3, sizeof(rb3)));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxinsv_middle)
+{
+	stx s1 = {0};
+	const spx segs[] = {
+		{.mem = rb2, .len = 10},
+		{.mem = rb3, .len = 20},
+	};
+
+	stxdup_mem(&s1, rb1, sizeof(rb1));
+
+	TEST_ASSERT(0 == stxinsv(&s1, 100, segs, 2));
+	TEST_ASSERT(sizeof(rb1) + 30 == s1.len);
+	TEST_ASSERT(0 == memcmp(s1.mem, rb1, 100));
+	TEST_ASSERT(0 == memcmp(s1.mem + 100, rb2, 10));
+	TEST_ASSERT(0 == memcmp(s1.mem + 110, rb3, 20));
+	TEST_ASSERT(0 == memcmp(s1.mem + 130, rb1 + 100, sizeof(rb1) - 100));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxinsv_past_end)
+{
+	stx s1 = {0};
+	const spx segs[] = {
+		{.mem = rb2, .len = 10},
+	};
+
+	stxdup_mem(&s1, rb1, 100);
+
+	// Nothing is written past the end, leaving a gap of unset bytes.
+	errno = 0;
+	TEST_ASSERT(-1 == stxinsv(&s1, 101, segs, 1));
+	TEST_ASSERT(EINVAL == errno);
+	TEST_ASSERT(100 == s1.len);
+
+	TEST_ASSERT(0 == stxinsv(&s1, 100, segs, 1));
+	TEST_ASSERT(110 == s1.len);
+	TEST_ASSERT(0 == memcmp(s1.mem + 100, rb2, 10));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxappiov_buffers)
+{
+	stx s1 = {0};
+	struct iovec iov[] = {
+		{.iov_base = rb1, .iov_len = sizeof(rb1)},
+		{.iov_base = rb2, .iov_len = 0},
+		{.iov_base = rb3, .iov_len = sizeof(rb3)},
+	};
+
+	stxdup_mem(&s1, rb2, 1);
+
+	TEST_ASSERT(0 == stxappiov(&s1, iov, 3));
+	TEST_ASSERT(1 + sizeof(rb1) + sizeof(rb3) == s1.len);
+	TEST_ASSERT(s1.len == s1.size);
+	TEST_ASSERT(rb2[0] == s1.mem[0]);
+	TEST_ASSERT(0 == memcmp(s1.mem + 1, rb1, sizeof(rb1)));
+	TEST_ASSERT(0 == memcmp(s1.mem + 1 + sizeof(rb1), rb3, sizeof(rb3)));
+
+	TEST_ASSERT(-1 == stxappiov(&s1, iov, -1));
+	TEST_ASSERT(0 == stxappiov(&s1, NULL, 0));
+	TEST_ASSERT(1 + sizeof(rb1) + sizeof(rb3) == s1.len);
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	test_rand_bytes(rb1, sizeof(rb1));
+	test_rand_bytes(rb2, sizeof(rb2));
+	test_rand_bytes(rb3, sizeof(rb3));
+
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxappv_zero);
+	TEST_RUN(ts, stxappv_segments);
+	TEST_RUN(ts, stxinsv_middle);
+	TEST_RUN(ts, stxinsv_past_end);
+	TEST_RUN(ts, stxappiov_buffers);
+	TEST_PRINT(ts);
+}
@@ -0,0 +1,152 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include "../libstx.h"
+#include "test.h"
+
+#define FILES 100
+
+static char contents[FILES][5000];
+static size_t lens[FILES];
+static int fds[FILES];
+
+static int
+mkfiles(void)
+{
+	size_t i;
+
+	for (i=0; i<FILES; ++i) {
+		char path[] = "/tmp/test_stxbulkreadXXXXXX";
+
+		lens[i] = test_rand(0, sizeof(contents[i]));
+		test_rand_bytes(contents[i], lens[i]);
+
+		if (-1 == (fds[i] = mkstemp(path)))
+			return -1;
+		unlink(path);
+
+		if ((ssize_t)lens[i] != write(fds[i], contents[i], lens[i]))
+			return -1;
+	}
+
+	return 0;
+}
+
+static void
+closefiles(void)
+{
+	size_t i;
+
+	for (i=0; i<FILES; ++i)
+		close(fds[i]);
+}
+
+static int
+readfiles(int flags)
+{
+	static stx bufs[FILES];
+	static stxreadreq reqs[FILES];
+	size_t i;
+	int ret = 0;
+
+	// Some buffers are too small for the file, some are partly used.
+	for (i=0; i<FILES; ++i) {
+		if (stxalloc(bufs + i, test_rand(1, 6000)))
+			return -1;
+		bufs[i].len = test_rand(0, 1) ? test_rand(0, bufs[i].size) : 0;
+
+		reqs[i].fd = fds[i];
+		reqs[i].off = test_rand(0, lens[i]);
+		reqs[i].buf = bufs + i;
+	}
+
+	if (stxbulkread(reqs, FILES, flags))
+		ret = -1;
+
+	for (i=0; i<FILES && !ret; ++i) {
+		size_t avail = lens[i] - reqs[i].off;
+		size_t want = bufs[i].size - (bufs[i].len - reqs[i].data.len);
+
+		if (reqs[i].err)
+			ret = -1;
+		else if (reqs[i].data.len != (avail < want ? avail : want))
+			ret = -1;
+		else if (reqs[i].data.mem + reqs[i].data.len != bufs[i].mem + bufs[i].len)
+			ret = -1;
+		else if (memcmp(reqs[i].data.mem, contents[i] + reqs[i].off, reqs[i].data.len))
+			ret = -1;
+	}
+
+	for (i=0; i<FILES; ++i)
+		stxfree(bufs + i);
+
+	return ret;
+}
+
+TEST_DEFINE(stxbulkread_default)
+{
+	TEST_ASSERT(0 == mkfiles());
+	TEST_ASSERT(0 == readfiles(0));
+	closefiles();
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxbulkread_threads)
+{
+	TEST_ASSERT(0 == mkfiles());
+	TEST_ASSERT(0 == readfiles(STXREAD_THREADS));
+	closefiles();
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxbulkread_fail)
+{
+	char path[] = "/tmp/test_stxbulkreadXXXXXX";
+	stx s1, s2;
+	stxreadreq reqs[2] = {
+		{.fd = -1, .buf = &s1},
+		{.fd = mkstemp(path), .buf = &s2},
+	};
+	int flags[] = {0, STXREAD_THREADS};
+	size_t i;
+
+	TEST_ASSERT(-1 != reqs[1].fd);
+	unlink(path);
+
+	stxalloc(&s1, 16);
+	stxalloc(&s2, 16);
+
+	// A full buffer reads nothing and succeeds.
+	s2.len = s2.size;
+
+	for (i=0; i<2; ++i) {
+		TEST_ASSERT(-1 == stxbulkread(reqs, 2, flags[i]));
+		TEST_ASSERT(EBADF == reqs[0].err);
+		TEST_ASSERT(0 == reqs[0].data.len);
+		TEST_ASSERT(0 == reqs[1].err);
+		TEST_ASSERT(0 == reqs[1].data.len);
+	}
+
+	close(reqs[1].fd);
+	stxfree(&s1);
+	stxfree(&s2);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxbulkread_default);
+	TEST_RUN(ts, stxbulkread_threads);
+	TEST_RUN(ts, stxbulkread_fail);
+	TEST_PRINT(ts);
+}
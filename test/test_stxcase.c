@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+static char
+lower(char c)
+{
+	return c >= 'A' && c <= 'Z' ? c + 32 : c;
+}
+
+static char
+upper(char c)
+{
+	return c >= 'a' && c <= 'z' ? c - 32 : c;
+}
+
+TEST_DEFINE(stxcase_ascii)
+{
+	stx s1;
+
+	stxdup_str(&s1, "Content-Type: Text/HTML; charset=UTF-8 [@`{]");
+
+	stxtolower(&s1);
+	TEST_ASSERT(0 == memcmp(s1.mem, "content-type: text/html; charset=utf-8 [@`{]", s1.len));
+	stxtoupper(&s1);
+	TEST_ASSERT(0 == memcmp(s1.mem, "CONTENT-TYPE: TEXT/HTML; CHARSET=UTF-8 [@`{]", s1.len));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxcase_bytes)
+{
+	char buf[300];
+	stx s1;
+	stx s2;
+	size_t i, n;
+
+	// Every length around the word and block sizes, with every byte value.
+	for (n=0; n<sizeof(buf); ++n) {
+		test_rand_bytes(buf, n);
+		if (n)
+			buf[n - 1] = n;
+
+		stxdup_mem(&s1, buf, n);
+		stxalloc(&s2, n);
+
+		stxtolower(&s1);
+		stxtoupper_spx(&s2, stxref(&s1));
+		TEST_ASSERT(n == s1.len && n == s2.len);
+		for (i=0; i<n; ++i) {
+			TEST_ASSERT(lower(buf[i]) == s1.mem[i]);
+			TEST_ASSERT(upper(buf[i]) == s2.mem[i]);
+		}
+
+		stxfree(&s1);
+		stxfree(&s2);
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxcase_copy)
+{
+	spx src = {.mem = "ABCdef", .len = 6};
+	stx s1;
+	stx s2;
+
+	stxalloc(&s1, 4);
+	stxtolower_spx(&s1, src);
+	TEST_ASSERT(4 == s1.len);
+	TEST_ASSERT(0 == memcmp(s1.mem, "abcd", 4));
+
+	// Shared memory is copied before converting it.
+	stxshare(&s2, &s1);
+	stxtoupper(&s2);
+	TEST_ASSERT(0 == memcmp(s1.mem, "abcd", 4));
+	TEST_ASSERT(0 == memcmp(s2.mem, "ABCD", 4));
+
+	stxfree(&s1);
+	stxfree(&s2);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxcase_ascii);
+	TEST_RUN(ts, stxcase_bytes);
+	TEST_RUN(ts, stxcase_copy);
+	TEST_PRINT(ts);
+}
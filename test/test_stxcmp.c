@@ -0,0 +1,91 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+static spx
+ref(const char *str)
+{
+	spx sp = {.mem = str, .len = strlen(str)};
+	return sp;
+}
+
+static int
+sign(int n)
+{
+	return (n > 0) - (n < 0);
+}
+
+TEST_DEFINE(stxcmp_equal)
+{
+	TEST_ASSERT(stxcmp(ref("Host"), ref("Host")));
+	TEST_ASSERT(!stxcmp(ref("Host"), ref("host")));
+	TEST_ASSERT(!stxcmp(ref("Host"), ref("Hos")));
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxicmp_equal)
+{
+	TEST_ASSERT(stxicmp(ref(""), ref("")));
+	TEST_ASSERT(stxicmp(ref("Content-Length"), ref("content-LENGTH")));
+	TEST_ASSERT(stxicmp(ref("X-Forwarded-For: Z"), ref("x-forwarded-for: z")));
+	TEST_ASSERT(!stxicmp(ref("Content-Length"), ref("Content-Lengti")));
+	TEST_ASSERT(!stxicmp(ref("Host"), ref("Hos")));
+
+	// Only ASCII letters fold, not the bytes next to them or utf8.
+	TEST_ASSERT(!stxicmp(ref("@[`{"), ref("`{@[")));
+	TEST_ASSERT(!stxicmp(ref("\xc3\x89t\xc3\xa9"), ref("\xc3\xa9t\xc3\xa9")));
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxicmp3_order)
+{
+	char s1[40], s2[40];
+	size_t i, j, n;
+
+	TEST_ASSERT(0 == stxicmp3(ref("ABCdefGHIjkl"), ref("abcDEFghiJKL")));
+	TEST_ASSERT(0 > stxicmp3(ref("abc"), ref("ABCD")));
+	TEST_ASSERT(0 < stxicmp3(ref("abd"), ref("ABCD")));
+	TEST_ASSERT(0 > stxicmp3(ref("Z"), ref("\xe0")));
+
+	// Agrees with comparing lower cased copies.
+	for (i=0; i<10000; ++i) {
+		n = test_rand(0, sizeof(s1) - 1);
+		test_rand_str(s1, n + 1);
+		memcpy(s2, s1, n + 1);
+		if (n)
+			s2[test_rand(0, n - 1)] = test_rand(1, 255);
+		if (n && test_rand(0, 1))
+			s2[test_rand(0, n - 1)] ^= 0x20;
+
+		for (j=0; j<n; ++j) {
+			s1[j] = s1[j] >= 'A' && s1[j] <= 'Z' ? s1[j] + 32 : s1[j];
+		}
+
+		int expect = 0;
+		for (j=0; j<n && !expect; ++j) {
+			unsigned char c2 = s2[j] >= 'A' && s2[j] <= 'Z' ? s2[j] + 32 : s2[j];
+			expect = (unsigned char)s1[j] - c2;
+		}
+
+		TEST_ASSERT(sign(expect) == stxicmp3(ref(s1), ref(s2)));
+		TEST_ASSERT(!expect == stxicmp(ref(s1), ref(s2)));
+	}
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxcmp_equal);
+	TEST_RUN(ts, stxicmp_equal);
+	TEST_RUN(ts, stxicmp3_order);
+	TEST_PRINT(ts);
+}
@@ -0,0 +1,304 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../libstx.h"
+#include "test.h"
+
+static const char *const levels[] = {
+	"scalar", "sse2", "sse4.2", "avx2", "avx512",
+};
+
+// Path of this program, run again by stxcpu_levels.
+static const char *self;
+
+static char
+lower(char c)
+{
+	return c >= 'A' && c <= 'Z' ? c + 32 : c;
+}
+
+// Bytes biased towards letters and bytes of multibyte utf8 encodings.
+static void
+rand_text(char *mem, size_t n)
+{
+	static const char pool[] = "aAzZmM@[`{ \t\x80\xBF\xC3\xE2\xF0\xFF\"\\\x1F" "09/:-.~%+";
+	size_t i;
+
+	for (i=0; i<n; ++i) {
+		if (rand() % 2)
+			mem[i] = pool[rand() % (sizeof(pool) - 1)];
+		else
+			mem[i] = rand() % 256;
+	}
+}
+
+TEST_DEFINE(stxcpu_level)
+{
+	const char *env = getenv("LIBSTX_CPU");
+	int level = stxcpu();
+
+	TEST_ASSERT(level >= STXCPU_SCALAR && level <= STXCPU_AVX512);
+
+	// A forced level is only ever lowered to.
+	if (env && 0 == strcmp(env, "scalar"))
+		TEST_ASSERT(STXCPU_SCALAR == level);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxcpu_utf8len)
+{
+	char buf[300];
+	size_t n, off, i;
+
+	TEST_ASSERT(0 == stxutf8len((spx){.mem = buf, .len = 0}));
+	TEST_ASSERT(5 == stxutf8len((spx){.mem = "h\xC3\xA9llo", .len = 6}));
+	TEST_ASSERT(2 == stxutf8len((spx){.mem = "\xF0\x9F\x98\x80\xE2\x82\xAC", .len = 7}));
+
+	for (n=0; n<200; ++n) {
+		size_t want = 0;
+
+		off = rand() % 64;
+		rand_text(buf + off, n);
+		for (i=0; i<n; ++i)
+			want += 0x80 != (buf[off + i] & 0xC0);
+
+		TEST_ASSERT(want == stxutf8len((spx){.mem = buf + off, .len = n}));
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxcpu_case)
+{
+	char src[300];
+	stx s1;
+	size_t n, i;
+
+	TEST_ASSERT(0 == stxalloc(&s1, sizeof(src)));
+
+	for (n=0; n<200; ++n) {
+		rand_text(src, n);
+		stxtolower_spx(&s1, (spx){.mem = src, .len = n});
+		TEST_ASSERT(n == s1.len);
+		for (i=0; i<n; ++i)
+			TEST_ASSERT(lower(src[i]) == s1.mem[i]);
+	}
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxcpu_icmp)
+{
+	char s1[200], s2[200];
+	size_t n, i;
+
+	for (n=1; n<150; ++n) {
+		rand_text(s1, n);
+		for (i=0; i<n; ++i)
+			s2[i] = rand() % 2 ? lower(s1[i]) : s1[i];
+
+		TEST_ASSERT(stxicmp((spx){.mem = s1, .len = n}, (spx){.mem = s2, .len = n}));
+		TEST_ASSERT(0 == stxicmp3((spx){.mem = s1, .len = n}, (spx){.mem = s2, .len = n}));
+
+		// A difference anywhere is found, with the byte order of the
+		// lower cased bytes.
+		i = rand() % n;
+		s2[i] = lower(s1[i]) == 'q' ? 'r' : 'q';
+		TEST_ASSERT(!stxicmp((spx){.mem = s1, .len = n}, (spx){.mem = s2, .len = n}));
+		TEST_ASSERT(((unsigned char)lower(s1[i]) < 'q' || 'r' == s2[i] ? -1 : 1) ==
+			stxicmp3((spx){.mem = s1, .len = n}, (spx){.mem = s2, .len = n}));
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxcpu_ifind)
+{
+	char hay[300];
+	size_t n, at;
+	spx found;
+
+	for (n=1; n<250; ++n) {
+		memset(hay, 'a', n);
+		at = rand() % n;
+		hay[at] = 'B';
+		found = stxifind_str((spx){.mem = hay, .len = n}, "b");
+		TEST_ASSERT(hay + at == found.mem);
+
+		// Matches are found up to the very end.
+		if (at + 2 <= n) {
+			hay[at + 1] = 'c';
+			found = stxifind_str((spx){.mem = hay, .len = n}, "bC");
+			TEST_ASSERT(hay + at == found.mem && 2 == found.len);
+		}
+
+		TEST_ASSERT(!stxifind_str((spx){.mem = hay, .len = n}, "x").mem);
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxcpu_strip)
+{
+	static const char set[] = " \t\r\n.,;:-_=+*#@!?\xFF";
+	char buf[300];
+	size_t n, len, head, tail, i;
+	stx s1;
+
+	TEST_ASSERT(0 == stxalloc(&s1, sizeof(buf)));
+
+	// Sets of up to 20 bytes, past the 16 a SSE4.2 comparison takes.
+	for (n=0; n<150; ++n) {
+		len = rand() % (sizeof(set) - 1) + 1;
+		head = n ? rand() % n : 0;
+		tail = n - head ? rand() % (n - head) : 0;
+
+		for (i=0; i<n; ++i)
+			buf[i] = set[rand() % len];
+		if (head + tail < n) {
+			buf[head] = 'x';
+			buf[n - 1 - tail] = 'y';
+		}
+
+		stxcpy_mem(&s1, buf, n);
+		stxstrip(&s1, set, len);
+
+		if (head + tail < n) {
+			TEST_ASSERT(n - head - tail == s1.len);
+			TEST_ASSERT(0 == memcmp(s1.mem, buf + head, s1.len));
+		} else {
+			// Nothing but set bytes strips to nothing.
+			TEST_ASSERT(0 == s1.len);
+		}
+	}
+
+	stxcpy_str(&s1, "  ");
+	TEST_ASSERT(0 == stxrstrip(&s1, " ", 1)->len);
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxcpu_jsonesc)
+{
+	char src[300];
+	size_t n, i, want;
+	stx s1;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 1));
+
+	for (n=0; n<200; ++n) {
+		rand_text(src, n);
+		for (i=0, want=n; i<n; ++i) {
+			unsigned char c = src[i];
+
+			if ('"' == c || '\\' == c || '\b' == c || '\f' == c ||
+			    '\n' == c || '\r' == c || '\t' == c)
+				want += 1;
+			else if (c < 0x20)
+				want += 5;
+		}
+
+		s1.len = 0;
+		TEST_ASSERT(0 == stxapp_jsonesc(&s1, (spx){.mem = src, .len = n}));
+		TEST_ASSERT(want == s1.len);
+	}
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxcpu_url)
+{
+	char src[300];
+	size_t n, i, want;
+	stx s1, s2;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 1));
+	TEST_ASSERT(0 == stxalloc(&s2, 1));
+
+	for (n=0; n<200; ++n) {
+		rand_text(src, n);
+		for (i=0, want=n; i<n; ++i) {
+			unsigned char c = src[i];
+
+			if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+			    (c >= '0' && c <= '9') || (c && strchr("-._~", c))))
+				want += 2;
+		}
+
+		s1.len = 0;
+		TEST_ASSERT(0 == stxapp_urlenc(&s1, (spx){.mem = src, .len = n}, 0));
+		TEST_ASSERT(want == s1.len);
+
+		// '+' scattered in runs of every length decode to spaces.
+		memset(src, 'a', n);
+		for (i=0; i<n; ++i)
+			if (0 == rand() % 4)
+				src[i] = '+';
+
+		s2.len = 0;
+		TEST_ASSERT(0 == stxapp_urldec(&s2, (spx){.mem = src, .len = n}, STXURL_PLUS));
+		TEST_ASSERT(n == s2.len);
+		for (i=0; i<n; ++i)
+			TEST_ASSERT(('+' == src[i] ? ' ' : 'a') == s2.mem[i]);
+	}
+
+	stxfree(&s1);
+	stxfree(&s2);
+
+	TEST_END;
+}
+
+// Run the tests again with every lower level forced.
+TEST_DEFINE(stxcpu_levels)
+{
+	int i, status;
+	pid_t pid;
+
+	fflush(stdout);
+
+	for (i=0; i<stxcpu(); ++i) {
+		TEST_ASSERT(-1 != (pid = fork()));
+		if (0 == pid) {
+			setenv("LIBSTX_CPU", levels[i], 1);
+			execl(self, self, (char *)NULL);
+			_exit(127);
+		}
+
+		TEST_ASSERT(pid == waitpid(pid, &status, 0));
+		TEST_ASSERT(WIFEXITED(status) && 0 == WEXITSTATUS(status));
+	}
+
+	TEST_END;
+}
+
+int
+main(int argc, char **argv)
+{
+	(void)argc;
+	self = argv[0];
+
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxcpu_level);
+	TEST_RUN(ts, stxcpu_utf8len);
+	TEST_RUN(ts, stxcpu_case);
+	TEST_RUN(ts, stxcpu_icmp);
+	TEST_RUN(ts, stxcpu_ifind);
+	TEST_RUN(ts, stxcpu_strip);
+	TEST_RUN(ts, stxcpu_jsonesc);
+	TEST_RUN(ts, stxcpu_url);
+	if (!getenv("LIBSTX_CPU"))
+		TEST_RUN(ts, stxcpu_levels);
+	TEST_PRINT(ts);
+}
@@ -116,6 +116,44 @@ TEST_DEFINE(stxcpy_str_twice)
 	TEST_END;
 }
 
+TEST_DEFINE(stxcpyf_twice)
+{
+	stx s1 = {0};
+
+	TEST_ASSERT(0 == stxcpyf(&s1, "%s %s", rs1, rs2));
+	TEST_ASSERT(strlen(rs1) + strlen(rs2) + 1 == s1.len);
+	TEST_ASSERT(0 == memcmp(s1.mem, rs1, strlen(rs1)));
+
+	TEST_ASSERT(0 == stxcpyf(&s1, "%d-%x", -12, 255u));
+	TEST_ASSERT(6 == s1.len);
+	TEST_ASSERT(0 == memcmp(s1.mem, "-12-ff", 6));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxcpyf_keep)
+{
+	stx s1 = {0};
+
+	TEST_ASSERT(0 == stxcpyf(&s1, "%s", "abc"));
+
+	// A failed call leaves the old contents.
+	TEST_ASSERT(-1 == stxcpyf(&s1, "%d %k", 1));
+	TEST_ASSERT(3 == s1.len);
+	TEST_ASSERT(0 == memcmp(s1.mem, "abc", 3));
+
+	// Arguments may point into the stx itself.
+	TEST_ASSERT(0 == stxcpyf(&s1, "[" STXFMT "|" STXFMT "]", STXARG(stxref(&s1)), STXARG(stxref(&s1))));
+	TEST_ASSERT(9 == s1.len);
+	TEST_ASSERT(0 == memcmp(s1.mem, "[abc|abc]", 10));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
 int
 main(void)
 {
@@ -133,5 +171,7 @@ main(void)
 	TEST_RUN(ts, stxcpy_str_zero);
 	TEST_RUN(ts, stxcpy_str_empty);
 	TEST_RUN(ts, stxcpy_str_twice);
+	TEST_RUN(ts, stxcpyf_twice);
+	TEST_RUN(ts, stxcpyf_keep);
 	TEST_PRINT(ts);
 }
@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+static const char b1[] = "abcabcabd abx";
+static const spx hay = {
+	.mem = b1,
+	.len = sizeof(b1) - 1,
+};
+
+TEST_DEFINE(stxfind_none)
+{
+	TEST_ASSERT(NULL == stxfind_str(hay, "").mem);
+	TEST_ASSERT(NULL == stxfind_str(hay, "abe").mem);
+	TEST_ASSERT(NULL == stxfind_str(hay, "abcabcabd abxy").mem);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxfind_first)
+{
+	spx found = stxfind_str(hay, "abcabd");
+
+	TEST_ASSERT(b1 + 3 == found.mem);
+	TEST_ASSERT(6 == found.len);
+
+	found = stxfind_str(hay, "a");
+	TEST_ASSERT(b1 == found.mem);
+	TEST_ASSERT(1 == found.len);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxfind_end)
+{
+	// The needle must not be matched past the end of the haystack.
+	spx part = stxslice(hay, 0, 12);
+	spx found = stxfind_str(hay, "abx");
+
+	TEST_ASSERT(b1 + 10 == found.mem);
+	TEST_ASSERT(NULL == stxfind_str(part, "abx").mem);
+	TEST_ASSERT(b1 + 8 == stxfind_str(part, "d ab").mem);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxifind_case)
+{
+	static const char b2[] = "Accept: */*\r\nCONTENT-type: text/plain\r\n";
+	spx h = {.mem = b2, .len = sizeof(b2) - 1};
+
+	TEST_ASSERT(b2 + 13 == stxifind_str(h, "content-type").mem);
+	TEST_ASSERT(b2 + 27 == stxifind_str(h, "TEXT/Plain").mem);
+	TEST_ASSERT(b2 == stxifind_str(h, "aCCEPT").mem);
+	TEST_ASSERT(b2 + 12 == stxifind_str(h, "\n").mem);
+	TEST_ASSERT(NULL == stxifind_str(h, "content-length").mem);
+	TEST_ASSERT(NULL == stxifind_str(h, "").mem);
+	TEST_ASSERT(NULL == stxifind_str(stxslice(h, 0, 36), "plain").mem);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxifind_rand)
+{
+	char hay[200], low[200], nd[8];
+	size_t i, j, n, len;
+
+	// Agrees with searching lower cased copies with stxfind.
+	for (i=0; i<20000; ++i) {
+		spx h, l;
+
+		n = test_rand(0, sizeof(hay));
+		len = test_rand(1, sizeof(nd));
+		for (j=0; j<n; ++j)
+			hay[j] = "aAbB\xc1\xe1@`"[test_rand(0, 7)];
+		for (j=0; j<len; ++j)
+			nd[j] = "aAbB\xc1\xe1@`"[test_rand(0, 7)];
+		for (j=0; j<n; ++j)
+			low[j] = hay[j] >= 'A' && hay[j] <= 'Z' ? hay[j] + 32 : hay[j];
+		for (j=0; j<len; ++j)
+			nd[j] = nd[j] >= 'A' && nd[j] <= 'Z' ? nd[j] + 32 : nd[j];
+
+		h.mem = hay;
+		h.len = n;
+		l.mem = low;
+		l.len = n;
+
+		spx found = stxifind_mem(h, nd, len);
+		spx expect = stxfind_mem(l, nd, len);
+
+		TEST_ASSERT(!found.mem == !expect.mem);
+		TEST_ASSERT(!found.mem || found.mem - hay == expect.mem - low);
+	}
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxfind_none);
+	TEST_RUN(ts, stxfind_first);
+	TEST_RUN(ts, stxfind_end);
+	TEST_RUN(ts, stxifind_case);
+	TEST_RUN(ts, stxifind_rand);
+	TEST_PRINT(ts);
+}
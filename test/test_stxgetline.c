@@ -0,0 +1,93 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../libstx.h"
+#include "test.h"
+
+TEST_DEFINE(stxgetline_pipe)
+{
+	static const char in[] = "first\n\nthird line\nno newline";
+	stxreader rd = {0};
+	spx line;
+	int fds[2];
+
+	TEST_ASSERT(0 == pipe(fds));
+	TEST_ASSERT(sizeof(in) - 1 == write(fds[1], in, sizeof(in) - 1));
+	close(fds[1]);
+
+	rd.fd = fds[0];
+	TEST_ASSERT(0 == stxalloc(&rd.buf, 64));
+
+	TEST_ASSERT(1 == stxgetline(&rd, &line));
+	TEST_ASSERT(stxcmp(line, (spx){.mem = "first", .len = 5}));
+	TEST_ASSERT(1 == stxgetline(&rd, &line));
+	TEST_ASSERT(0 == line.len);
+	TEST_ASSERT(1 == stxgetline(&rd, &line));
+	TEST_ASSERT(stxcmp(line, (spx){.mem = "third line", .len = 10}));
+	TEST_ASSERT(1 == stxgetline(&rd, &line));
+	TEST_ASSERT(stxcmp(line, (spx){.mem = "no newline", .len = 10}));
+	TEST_ASSERT(0 == stxgetline(&rd, &line));
+	TEST_ASSERT(0 == stxgetline(&rd, &line));
+
+	close(fds[0]);
+	stxfree(&rd.buf);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxgetline_straddle)
+{
+	char path[] = "/tmp/test_stxgetlineXXXXXX";
+	char in[20000];
+	stxreader rd = {0};
+	spx line;
+	size_t pos = 0;
+	size_t i;
+	int fd;
+
+	// Lines both shorter and longer than the initial buffer.
+	test_rand_bytes(in, sizeof(in));
+	for (i=0; i<sizeof(in); ++i) {
+		if ('\n' == in[i])
+			in[i] = 'x';
+	}
+	for (i=test_rand(0, 40); i<sizeof(in); i+=test_rand(1, 100))
+		in[i] = '\n';
+
+	TEST_ASSERT(-1 != (fd = mkstemp(path)));
+	TEST_ASSERT(sizeof(in) == write(fd, in, sizeof(in)));
+	TEST_ASSERT(0 == lseek(fd, 0, SEEK_SET));
+	unlink(path);
+
+	rd.fd = fd;
+	TEST_ASSERT(0 == stxalloc(&rd.buf, 16));
+
+	while (1 == stxgetline(&rd, &line)) {
+		const char *nl = memchr(in + pos, '\n', sizeof(in) - pos);
+		size_t len = nl ? (size_t)(nl - in) - pos : sizeof(in) - pos;
+
+		TEST_ASSERT(len == line.len);
+		TEST_ASSERT(0 == memcmp(in + pos, line.mem, len));
+		pos += len + !!nl;
+	}
+
+	TEST_ASSERT(sizeof(in) == pos);
+
+	close(fd);
+	stxfree(&rd.buf);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxgetline_pipe);
+	TEST_RUN(ts, stxgetline_straddle);
+	TEST_PRINT(ts);
+}
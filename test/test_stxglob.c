@@ -0,0 +1,135 @@
+#include <fnmatch.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+#define SP(s) ((spx){.mem = (s), .len = strlen(s)})
+
+struct want {
+	const char *pattern;
+	const char *text;
+	bool match;
+};
+
+static const struct want cases[] = {
+	{"", "", true},
+	{"", "a", false},
+	{"*", "", true},
+	{"*", "/any/path", true},
+	{"abc", "abc", true},
+	{"abc", "abcd", false},
+	{"a?c", "abc", true},
+	{"a?c", "ac", false},
+	{"*.c", "src/stxglob.c", true},
+	{"*.c", "src/stxglob.h", false},
+	{"/api/*/users/*", "/api/v1/users/42", true},
+	{"/api/*/users/*", "/api/v1/groups/42", false},
+	{"a*b*c", "aXbYbZc", true},
+	{"a*b*c", "aXcYb", false},
+	{"*ab*ab*", "abab", true},
+	{"*ab*ab*", "aba", false},
+	{"*aab", "aaab", true},
+	{"[abc]x", "bx", true},
+	{"[a-c]x", "dx", false},
+	{"[!a-c]x", "dx", true},
+	{"[^a-c]x", "ax", false},
+	{"[]]", "]", true},
+	{"[!]]", "]", false},
+	{"[a-]", "-", true},
+	{"[", "[", true},
+	{"a[b", "a[b", true},
+	// An unclosed '[' is a literal byte and leaves nothing of its bytes in the set.
+	{"[ab", "[ab", true},
+	{"[ab", "aab", false},
+	{"x[yz", "xyyz", false},
+	{"[*", "*", false},
+	{"[*", "[x", true},
+	{"[!a", "a!a", false},
+	{"\\*", "*", true},
+	{"\\*", "a", false},
+	{"[\\]]", "]", true},
+	{"*[0-9]?.log", "app-12.log", true},
+	{"*[0-9]?.log", "app-x2.log", false},
+};
+
+TEST_DEFINE(stxglob_cases)
+{
+	stxglob *g;
+	size_t i;
+
+	for (i=0; i<sizeof(cases) / sizeof(*cases); ++i) {
+		TEST_ASSERT(0 == stxglobcomp(&g, SP(cases[i].pattern)));
+		TEST_ASSERT(cases[i].match == stxglobmatch(g, SP(cases[i].text)));
+		stxglobfree(g);
+	}
+
+	TEST_END;
+}
+
+// Random patterns must match like fnmatch(3) without flags.
+TEST_DEFINE(stxglob_fnmatch)
+{
+	static const char *const parts[] = {
+		"a", "b", "ab", "*", "?", "[ab]", "[!a]", "[a-b]", "\\*", "*", "[",
+	};
+	char pattern[64], text[32];
+	stxglob *g;
+	int i, k, n;
+
+	for (i=0; i<20000; ++i) {
+		pattern[0] = '\0';
+		n = test_rand(0, 6);
+		for (k=0; k<n; ++k)
+			strcat(pattern, parts[rand() % (sizeof(parts) / sizeof(*parts))]);
+
+		n = test_rand(0, sizeof(text) - 1);
+		for (k=0; k<n; ++k)
+			text[k] = "ab*["[rand() % 4];
+		text[n] = '\0';
+
+		TEST_ASSERT(0 == stxglobcomp(&g, SP(pattern)));
+		TEST_ASSERT((0 == fnmatch(pattern, text, 0)) == stxglobmatch(g, SP(text)));
+		stxglobfree(g);
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxglob_linear)
+{
+	size_t n = 1 << 20;
+	char *text = malloc(n);
+	stxglob *g;
+
+	TEST_ASSERT(text);
+	memset(text, 'a', n);
+
+	// Backtracking over each '*' takes exponential time on these.
+	TEST_ASSERT(0 == stxglobcomp(&g, SP("*a*a*a*a*a*a*a*a*b")));
+	TEST_ASSERT(!stxglobmatch(g, (spx){.mem = text, .len = n}));
+	text[n - 1] = 'b';
+	TEST_ASSERT(stxglobmatch(g, (spx){.mem = text, .len = n}));
+	stxglobfree(g);
+
+	TEST_ASSERT(0 == stxglobcomp(&g, SP("*?a?a?a?*c")));
+	TEST_ASSERT(!stxglobmatch(g, (spx){.mem = text, .len = n}));
+	stxglobfree(g);
+
+	free(text);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxglob_cases);
+	TEST_RUN(ts, stxglob_fnmatch);
+	TEST_RUN(ts, stxglob_linear);
+	TEST_PRINT(ts);
+}
@@ -0,0 +1,84 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+static char buf[300000];
+
+TEST_DEFINE(stxhash_stable)
+{
+	spx sp = {.mem = buf, .len = sizeof(buf)};
+
+	test_rand_bytes(buf, sizeof(buf));
+
+	TEST_ASSERT(stxhash(sp) == stxhash(sp));
+	TEST_ASSERT(stxhash((spx){.mem = "", .len = 0}) == stxhash((spx){.mem = buf, .len = 0}));
+	TEST_ASSERT(stxhash((spx){.mem = "libstx", .len = 6}) ==
+		stxhash((spx){.mem = "xlibstx" + 1, .len = 6}));
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxhash_differs)
+{
+	spx sp = {.mem = buf, .len = sizeof(buf)};
+	uint64_t h, prev = 0;
+	size_t n, i;
+
+	test_rand_bytes(buf, sizeof(buf));
+
+	// Every length of the same bytes, including the ones that fit in a
+	// single multiply, hashes differently.
+	for (n=0; n<100; ++n) {
+		h = stxhash((spx){.mem = buf, .len = n});
+		TEST_ASSERT(n == 0 || h != prev);
+		prev = h;
+	}
+
+	memset(buf, 0, 64);
+	TEST_ASSERT(stxhash((spx){.mem = buf, .len = 16}) != stxhash((spx){.mem = buf, .len = 17}));
+
+	// Flipping a single bit anywhere, in any block, changes the hash.
+	h = stxhash(sp);
+	for (n=0; n<200; ++n) {
+		int bit = 1 << (rand() % 8);
+
+		i = test_rand(0, sizeof(buf) - 1);
+		buf[i] ^= bit;
+		TEST_ASSERT(h != stxhash(sp));
+		buf[i] ^= bit;
+		TEST_ASSERT(h == stxhash(sp));
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxhash_blocks)
+{
+	spx sp = {.mem = buf, .len = 131072};
+	uint64_t h;
+
+	// Swapping two equal sized blocks changes the hash.
+	memset(buf, 'a', 65536);
+	memset(buf + 65536, 'b', 65536);
+	h = stxhash(sp);
+
+	memset(buf, 'b', 65536);
+	memset(buf + 65536, 'a', 65536);
+	TEST_ASSERT(h != stxhash(sp));
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxhash_stable);
+	TEST_RUN(ts, stxhash_differs);
+	TEST_RUN(ts, stxhash_blocks);
+	TEST_PRINT(ts);
+}
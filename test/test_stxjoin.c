@@ -0,0 +1,101 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+static const spx parts[] = {
+	{.mem = "id", .len = 2},
+	{.mem = "", .len = 0},
+	{.mem = "name", .len = 4},
+	{.mem = "value", .len = 5},
+};
+static const spx comma = {.mem = ", ", .len = 2};
+
+TEST_DEFINE(stxjoin_zero)
+{
+	stx s1 = {0};
+
+	TEST_ASSERT(0 == stxjoin(&s1, parts, 0, comma));
+	TEST_ASSERT(NULL == s1.mem);
+	TEST_ASSERT(0 == s1.len);
+	TEST_ASSERT(0 == s1.size);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxjoin_one)
+{
+	stx s1 = {0};
+
+	TEST_ASSERT(0 == stxjoin(&s1, parts, 1, comma));
+	TEST_ASSERT(2 == s1.len);
+	TEST_ASSERT(2 == s1.size);
+	TEST_ASSERT(0 == memcmp(s1.mem, "id", 2));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxjoin_exact_size)
+{
+	stx s1 = {0};
+	const char *want = "id, , name, value";
+
+	TEST_ASSERT(0 == stxjoin(&s1, parts, 4, comma));
+	TEST_ASSERT(strlen(want) == s1.len);
+	TEST_ASSERT(strlen(want) == s1.size);
+	TEST_ASSERT(0 == memcmp(s1.mem, want, s1.len));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxjoin_append)
+{
+	stx s1;
+	const spx none = {0};
+	const char *want = "row:idnamevalue";
+
+	stxalloc(&s1, 64);
+	stxapp_str(&s1, "row:");
+
+	TEST_ASSERT(0 == stxjoin(&s1, parts, 4, none));
+	TEST_ASSERT(strlen(want) == s1.len);
+	TEST_ASSERT(64 == s1.size);
+	TEST_ASSERT(0 == memcmp(s1.mem, want, s1.len));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxjoin_overflow)
+{
+	stx s1 = {0};
+	const spx huge[] = {
+		{.mem = "", .len = SIZE_MAX / 2},
+		{.mem = "", .len = SIZE_MAX / 2},
+	};
+
+	TEST_ASSERT(-1 == stxjoin(&s1, huge, 2, comma));
+	TEST_ASSERT(NULL == s1.mem);
+	TEST_ASSERT(0 == s1.len);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxjoin_zero);
+	TEST_RUN(ts, stxjoin_one);
+	TEST_RUN(ts, stxjoin_exact_size);
+	TEST_RUN(ts, stxjoin_append);
+	TEST_RUN(ts, stxjoin_overflow);
+	TEST_PRINT(ts);
+}
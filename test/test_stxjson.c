@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+#define SP(s) ((spx){.mem = (s), .len = sizeof(s) - 1})
+
+TEST_DEFINE(stxapp_jsonesc_bytes)
+{
+	stx s1;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 1));
+	stxcpy_str(&s1, "x");
+
+	TEST_ASSERT(0 == stxapp_jsonesc(&s1, SP("a\"b\\c/\b\f\n\r\t\x01\x1F\x7F\xC3\xA9")));
+	TEST_ASSERT(stxcmp(stxref(&s1),
+		SP("xa\\\"b\\\\c/\\b\\f\\n\\r\\t\\u0001\\u001f\x7F\xC3\xA9")));
+
+	s1.len = 0;
+	TEST_ASSERT(0 == stxapp_jsonesc(&s1, SP("")));
+	TEST_ASSERT(0 == s1.len);
+	TEST_ASSERT(0 == stxapp_jsonesc(&s1, SP("\0")));
+	TEST_ASSERT(stxcmp(stxref(&s1), SP("\\u0000")));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxapp_jsonesc_runs)
+{
+	char src[300];
+	stx s1;
+	size_t n, at, i;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 1));
+
+	// A single byte to escape anywhere in runs of every length, past the
+	// blocks of the vector kernels included.
+	for (n=1; n<sizeof(src); ++n) {
+		memset(src, 'a', n);
+		at = rand() % n;
+		src[at] = "\"\\\n\x02"[rand() % 4];
+
+		s1.len = 0;
+		TEST_ASSERT(0 == stxapp_jsonesc(&s1, (spx){.mem = src, .len = n}));
+		TEST_ASSERT(n + ('\x02' == src[at] ? 5 : 1) == s1.len);
+		TEST_ASSERT('\\' == s1.mem[at]);
+		for (i=0; i<at; ++i)
+			TEST_ASSERT('a' == s1.mem[i]);
+	}
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxapp_jsonunesc_escapes)
+{
+	stx s1;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 1));
+
+	TEST_ASSERT(0 == stxapp_jsonunesc(&s1, SP("a\\\"b\\\\c\\/\\b\\f\\n\\r\\t")));
+	TEST_ASSERT(stxcmp(stxref(&s1), SP("a\"b\\c/\b\f\n\r\t")));
+
+	// Code points of 1 to 4 utf8 bytes, the last one a surrogate pair.
+	s1.len = 0;
+	TEST_ASSERT(0 == stxapp_jsonunesc(&s1, SP("\\u0041\\u00e9\\u20AC\\ud83d\\ude00!")));
+	TEST_ASSERT(stxcmp(stxref(&s1), SP("A\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80!")));
+
+	s1.len = 0;
+	TEST_ASSERT(0 == stxapp_jsonunesc(&s1, SP("\\udbff\\udfff\\u0000")));
+	TEST_ASSERT(stxcmp(stxref(&s1), SP("\xF4\x8F\xBF\xBF\0")));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxapp_jsonunesc_invalid)
+{
+	static const char *const invalid[] = {
+		"\\", "a\\", "\\x", "\\u12", "\\u12g4", "\\ud83d", "\\ud83dx",
+		"\\ud83d\\u0041", "\\ude00", "\\U0041",
+	};
+	stx s1;
+	size_t i;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 16));
+	stxcpy_str(&s1, "kept");
+
+	// Nothing is appended when an escape is invalid.
+	for (i=0; i<sizeof(invalid) / sizeof(*invalid); ++i) {
+		TEST_ASSERT(-1 == stxapp_jsonunesc(&s1, (spx){.mem = invalid[i], .len = strlen(invalid[i])}));
+		TEST_ASSERT(stxcmp(stxref(&s1), SP("kept")));
+	}
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxjson_roundtrip)
+{
+	char src[1000];
+	stx s1, s2;
+	size_t n;
+	int i;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 1));
+	TEST_ASSERT(0 == stxalloc(&s2, 1));
+
+	for (i=0; i<200; ++i) {
+		n = test_rand(0, sizeof(src));
+		test_rand_bytes(src, n);
+
+		s1.len = 0;
+		s2.len = 0;
+		TEST_ASSERT(0 == stxapp_jsonesc(&s1, (spx){.mem = src, .len = n}));
+		TEST_ASSERT(0 == stxapp_jsonunesc(&s2, stxref(&s1)));
+		TEST_ASSERT(n == s2.len && 0 == memcmp(src, s2.mem, n));
+	}
+
+	stxfree(&s1);
+	stxfree(&s2);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxapp_jsonesc_bytes);
+	TEST_RUN(ts, stxapp_jsonesc_runs);
+	TEST_RUN(ts, stxapp_jsonunesc_escapes);
+	TEST_RUN(ts, stxapp_jsonunesc_invalid);
+	TEST_RUN(ts, stxjson_roundtrip);
+	TEST_PRINT(ts);
+}
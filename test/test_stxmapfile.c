@@ -0,0 +1,92 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../libstx.h"
+#include "test.h"
+
+static char path[] = "/tmp/test_stxmapfileXXXXXX";
+
+static int
+mkfile(const char *buf, size_t n)
+{
+	int fd = mkstemp(path);
+
+	if (-1 == fd)
+		return -1;
+
+	if ((ssize_t)n != write(fd, buf, n)) {
+		close(fd);
+		return -1;
+	}
+
+	return close(fd);
+}
+
+TEST_DEFINE(stxmapfile_contents)
+{
+	char buf[9000];
+	stxmap m;
+	spx sp;
+
+	test_rand_bytes(buf, sizeof(buf));
+	memcpy(buf + sizeof(buf) - 6, "needle", 6);
+	strcpy(path, "/tmp/test_stxmapfileXXXXXX");
+	TEST_ASSERT(0 == mkfile(buf, sizeof(buf)));
+
+	TEST_ASSERT(0 == stxmapfile(path, &sp, &m,
+		STXMAP_SEQUENTIAL | STXMAP_WILLNEED | STXMAP_HUGEPAGE));
+	TEST_ASSERT(sizeof(buf) == sp.len);
+	TEST_ASSERT(0 == memcmp(buf, sp.mem, sp.len));
+	TEST_ASSERT(sp.mem + sp.len - 6 == stxfind_str(sp, "needle").mem);
+
+	TEST_ASSERT(0 == stxunmapfile(&m));
+	TEST_ASSERT(NULL == m.addr);
+	TEST_ASSERT(0 == stxunmapfile(&m));
+
+	unlink(path);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxmapfile_empty)
+{
+	stxmap m;
+	spx sp;
+
+	strcpy(path, "/tmp/test_stxmapfileXXXXXX");
+	TEST_ASSERT(0 == mkfile("", 0));
+
+	TEST_ASSERT(0 == stxmapfile(path, &sp, &m, 0));
+	TEST_ASSERT(NULL == sp.mem);
+	TEST_ASSERT(0 == sp.len);
+	TEST_ASSERT(0 == stxunmapfile(&m));
+
+	unlink(path);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxmapfile_missing)
+{
+	stxmap m;
+	spx sp;
+
+	TEST_ASSERT(-1 == stxmapfile("/nonexistent/stxmapfile", &sp, &m, 0));
+	TEST_ASSERT(-1 == stxmapfile("/tmp", &sp, &m, 0));
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxmapfile_contents);
+	TEST_RUN(ts, stxmapfile_empty);
+	TEST_RUN(ts, stxmapfile_missing);
+	TEST_PRINT(ts);
+}
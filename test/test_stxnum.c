@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+static char buf[64];
+static stx s1 = {
+	.mem = buf,
+	.size = sizeof(buf),
+};
+
+static uint64_t
+rand_u64(void)
+{
+	uint64_t v = 0;
+	test_rand_bytes(&v, sizeof(v));
+	// Spread the number of digits evenly.
+	return v >> (rand() % 64);
+}
+
+TEST_DEFINE(stxapp_u64_rand)
+{
+	char ref[32];
+
+	for (int i=0; i<100000; ++i) {
+		uint64_t v = i < 2 ? (i ? UINT64_MAX : 0) : rand_u64();
+		int n = snprintf(ref, sizeof(ref), "%" PRIu64, v);
+
+		s1.len = 0;
+		TEST_ASSERT(&s1 == stxapp_u64(&s1, v));
+		TEST_ASSERT((size_t)n == s1.len);
+		TEST_ASSERT(0 == memcmp(s1.mem, ref, n));
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxapp_i64_rand)
+{
+	char ref[32];
+
+	for (int i=0; i<100000; ++i) {
+		int64_t v = i < 2 ? (i ? INT64_MAX : INT64_MIN) : (int64_t)rand_u64();
+		int n = snprintf(ref, sizeof(ref), "%" PRId64, v);
+
+		s1.len = 0;
+		TEST_ASSERT(&s1 == stxapp_i64(&s1, v));
+		TEST_ASSERT((size_t)n == s1.len);
+		TEST_ASSERT(0 == memcmp(s1.mem, ref, n));
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxapp_hex_rand)
+{
+	char ref[32];
+
+	for (int i=0; i<100000; ++i) {
+		uint64_t v = i < 2 ? (i ? UINT64_MAX : 0) : rand_u64();
+		int n = snprintf(ref, sizeof(ref), "%" PRIx64, v);
+
+		s1.len = 0;
+		TEST_ASSERT(&s1 == stxapp_hex(&s1, v));
+		TEST_ASSERT((size_t)n == s1.len);
+		TEST_ASSERT(0 == memcmp(s1.mem, ref, n));
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxapp_f64_known)
+{
+	static const struct {
+		double d;
+		const char *str;
+	} known[] = {
+		{0.0, "0"},
+		{-0.0, "-0"},
+		{1.0, "1"},
+		{-2.5, "-2.5"},
+		{0.1, "0.1"},
+		{0.3, "0.3"},
+		{100.0, "100"},
+		{0.0001, "0.0001"},
+		{0.00001, "1e-05"},
+		{1e15, "1000000000000000"},
+		{1e16, "1e+16"},
+		{1e23, "1e+23"},
+		{5e-324, "5e-324"},
+		{1.7976931348623157e308, "1.7976931348623157e+308"},
+		{1.0 / 0.0, "inf"},
+		{-1.0 / 0.0, "-inf"},
+	};
+
+	for (size_t i=0; i<sizeof(known)/sizeof(*known); ++i) {
+		s1.len = 0;
+		TEST_ASSERT(&s1 == stxapp_f64(&s1, known[i].d));
+		TEST_ASSERT(strlen(known[i].str) == s1.len);
+		TEST_ASSERT(0 == memcmp(s1.mem, known[i].str, s1.len));
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxapp_f64_roundtrip)
+{
+	for (int i=0; i<100000; ++i) {
+		uint64_t bits;
+		double d;
+
+		test_rand_bytes(&bits, sizeof(bits));
+		memcpy(&d, &bits, sizeof(d));
+		if (d != d || d - d != 0)
+			continue;
+
+		s1.len = 0;
+		TEST_ASSERT(&s1 == stxapp_f64(&s1, d));
+		buf[s1.len] = '\0';
+		TEST_ASSERT(d == strtod(buf, NULL));
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxapp_num_no_room)
+{
+	stx s2 = {
+		.mem = buf,
+		.len = sizeof(buf) - 2,
+		.size = sizeof(buf),
+	};
+
+	TEST_ASSERT(&s2 == stxapp_u64(&s2, 123));
+	TEST_ASSERT(&s2 == stxapp_i64(&s2, -12));
+	TEST_ASSERT(&s2 == stxapp_hex(&s2, 0xABC));
+	TEST_ASSERT(&s2 == stxapp_f64(&s2, 0.5));
+	TEST_ASSERT(sizeof(buf) - 2 == s2.len);
+
+	TEST_ASSERT(&s2 == stxapp_u64(&s2, 12));
+	TEST_ASSERT(sizeof(buf) == s2.len);
+
+	// Short of room for the longest double, one that fits is still appended.
+	s2.len = sizeof(buf) - 5;
+	TEST_ASSERT(&s2 == stxapp_f64(&s2, 0.25));
+	TEST_ASSERT(sizeof(buf) - 1 == s2.len);
+	TEST_ASSERT(0 == memcmp(buf + sizeof(buf) - 5, "0.25", 4));
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxapp_u64_rand);
+	TEST_RUN(ts, stxapp_i64_rand);
+	TEST_RUN(ts, stxapp_hex_rand);
+	TEST_RUN(ts, stxapp_f64_known);
+	TEST_RUN(ts, stxapp_f64_roundtrip);
+	TEST_RUN(ts, stxapp_num_no_room);
+	TEST_PRINT(ts);
+}
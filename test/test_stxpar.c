@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+#define HAY 1048576
+
+static char hay[HAY];
+
+// Run the chunks from the last one, so later matches are found first.
+static void
+backwards(void *ctx, size_t n, void (*fn)(void *arg, size_t i), void *arg)
+{
+	size_t *calls = ctx;
+
+	while (n--) {
+		fn(arg, n);
+		++*calls;
+	}
+}
+
+static void
+rand_ab(char *mem, size_t n)
+{
+	size_t i;
+
+	for (i=0; i<n; ++i)
+		mem[i] = 'a' + rand() % 2;
+}
+
+// Occurrences, overlapping ones included.
+static size_t
+count(spx h, spx nd)
+{
+	size_t n = 0;
+	size_t i;
+
+	for (i=0; i + nd.len <= h.len; ++i)
+		n += 0 == memcmp(h.mem + i, nd.mem, nd.len);
+
+	return n;
+}
+
+TEST_DEFINE(stxfind_par_boundaries)
+{
+	stxparopts opts = {.threads = 4, .threshold = 1};
+	spx h = {.mem = hay, .len = HAY};
+	spx nd = {.mem = "needle", .len = 6};
+	// Chunks are 64 KiB here, some of these straddle two chunks.
+	size_t at[] = {0, 65530, 65535, 65536, 131071, 500000, 900000};
+	size_t i;
+	spx found;
+
+	memset(hay, 'a', HAY);
+	TEST_ASSERT(!stxfind_par(h, nd, &opts).mem);
+
+	memcpy(hay + HAY - nd.len, nd.mem, nd.len);
+	found = stxfind_par(h, nd, &opts);
+	TEST_ASSERT(hay + HAY - nd.len == found.mem && nd.len == found.len);
+
+	memcpy(hay + 900000, nd.mem, nd.len);
+	for (i=0; i<sizeof(at) / sizeof(*at); ++i) {
+		memcpy(hay + at[i], nd.mem, nd.len);
+		found = stxfind_par(h, nd, &opts);
+		TEST_ASSERT(hay + at[i] == found.mem && nd.len == found.len);
+		memset(hay + at[i], 'a', nd.len);
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxfind_par_random)
+{
+	stxparopts opts = {.threads = 3, .threshold = 1};
+	spx h = {.mem = hay, .len = HAY};
+	char nd[24];
+	spx needle;
+	int i;
+
+	rand_ab(hay, HAY);
+
+	// Long needles of two letters are rare enough to land anywhere.
+	for (i=0; i<20; ++i) {
+		needle = (spx){.mem = nd, .len = test_rand(1, sizeof(nd))};
+		rand_ab(nd, needle.len);
+		TEST_ASSERT(stxfind_spx(h, needle).mem == stxfind_par(h, needle, &opts).mem);
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxfind_par_exec)
+{
+	size_t calls = 0;
+	stxparopts opts = {.threshold = 1, .exec = backwards, .ctx = &calls};
+	spx h = {.mem = hay, .len = HAY};
+	spx nd = {.mem = "xyz", .len = 3};
+
+	memset(hay, 'a', HAY);
+	memcpy(hay + 70000, "xyz", 3);
+	memcpy(hay + 1000000, "xyz", 3);
+
+	TEST_ASSERT(hay + 70000 == stxfind_par(h, nd, &opts).mem);
+	TEST_ASSERT(calls > 1);
+	TEST_ASSERT(2 == stxcount_par(h, nd, &opts));
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxcount_par_overlapping)
+{
+	stxparopts opts = {.threads = 4, .threshold = 1};
+	spx h = {.mem = hay, .len = HAY};
+	spx nd = {.mem = "abab", .len = 4};
+	spx small = {.mem = hay, .len = 1000};
+
+	rand_ab(hay, HAY);
+
+	TEST_ASSERT(count(h, nd) == stxcount_par(h, nd, &opts));
+	TEST_ASSERT(count(small, nd) == stxcount_par(small, nd, NULL));
+	TEST_ASSERT(3 == stxcount_par((spx){.mem = "aaaa", .len = 4}, (spx){.mem = "aa", .len = 2}, NULL));
+	TEST_ASSERT(0 == stxcount_par((spx){.mem = "a", .len = 1}, (spx){.mem = "aa", .len = 2}, NULL));
+
+	TEST_END;
+}
+
+// Text of 1 to 4 byte encodings, so chunks start in the middle of some.
+static void
+rand_utf8(char *mem, size_t n)
+{
+	static const char *const enc[] = {"a", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80"};
+	size_t i, k;
+
+	for (i=0; i<n; i += k + 1) {
+		k = rand() % 4;
+		if (i + k >= n)
+			k = 0;
+		memcpy(mem + i, enc[k], k + 1);
+	}
+}
+
+TEST_DEFINE(stxpar_reductions)
+{
+	stxparopts opts = {.threads = 4, .threshold = 1};
+	size_t lens[] = {0, 1, 65535, 65536, 65537, 300001, HAY};
+	size_t i, at;
+	spx sp;
+
+	rand_utf8(hay, HAY);
+
+	for (i=0; i<sizeof(lens) / sizeof(*lens); ++i) {
+		sp = (spx){.mem = hay, .len = lens[i]};
+		TEST_ASSERT(stxutf8len(sp) == stxutf8len_par(sp, &opts));
+		TEST_ASSERT(stxutf8valid(sp) == stxutf8valid_par(sp, &opts));
+		TEST_ASSERT(stxhash(sp) == stxhash_par(sp, &opts));
+		TEST_ASSERT(stxhash(sp) == stxhash_par(sp, NULL));
+	}
+
+	sp = (spx){.mem = hay, .len = HAY};
+	TEST_ASSERT(stxutf8valid_par(sp, &opts));
+
+	// Broken encodings are found wherever they are, chunk boundaries
+	// included.
+	for (i=0; i<50; ++i) {
+		at = i < 5 ? 65536 * (i + 1) - 1 + i % 2 : test_rand(0, HAY - 1);
+		hay[at] ^= 0x40;
+		TEST_ASSERT(stxutf8valid(sp) == stxutf8valid_par(sp, &opts));
+		TEST_ASSERT(stxutf8len(sp) == stxutf8len_par(sp, &opts));
+		hay[at] ^= 0x40;
+	}
+
+	// Runs of more continuation bytes than an encoding has.
+	memset(hay + 65534, 0x80, 5);
+	TEST_ASSERT(!stxutf8valid_par(sp, &opts));
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxfind_par_boundaries);
+	TEST_RUN(ts, stxfind_par_random);
+	TEST_RUN(ts, stxfind_par_exec);
+	TEST_RUN(ts, stxcount_par_overlapping);
+	TEST_RUN(ts, stxpar_reductions);
+	TEST_PRINT(ts);
+}
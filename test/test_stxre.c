@@ -0,0 +1,257 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+#define SP(s) ((spx){.mem = (s), .len = strlen(s)})
+
+// Offset and length of the match in "text", or -1 for no match.
+struct want {
+	const char *pattern;
+	const char *text;
+	int at;
+	int len;
+};
+
+static const struct want cases[] = {
+	{"abc", "xxabcabc", 2, 3},
+	{"", "abc", 0, 0},
+	{"a*", "bbb", 0, 0},
+	{"a+", "bbaaab", 2, 3},
+	{"a+?", "bbaaab", 2, 1},
+	{"a|ab", "xab", 1, 1},
+	{"ab|a", "xab", 1, 2},
+	{"(a|ab)(c|bcd)", "abcd", 0, 4},
+	{"x*y", "xxxz xy", 5, 2},
+	{"colou?r", "the color", 4, 5},
+	{"^abc", "abcabc", 0, 3},
+	{"^abc", "xabc", -1, 0},
+	{"abc$", "abcabc", 3, 3},
+	{"^$", "", 0, 0},
+	{"^$", "a", -1, 0},
+	{"a$|b", "ba", 0, 1},
+	{"[a-c]+", "xxbcaz", 2, 3},
+	{"[^a-c]+", "abxyc", 2, 2},
+	{"[]a]+", "x]a]", 1, 3},
+	{"[a-]+", "x-a-", 1, 3},
+	{"\\d+\\.\\d*", "v 12.5x", 2, 4},
+	{"\\w+", "  foo_1 ", 2, 5},
+	{"\\s+\\S", "a \t b", 1, 4},
+	{"[\\d.]+", "ip 10.0.0.1!", 3, 8},
+	{"\\x41+", "zAAA", 1, 3},
+	{"a.c", "a\nc abc", 4, 3},
+	{"a{3}", "aaaa", 0, 3},
+	{"a{2,}", "a aaaaa", 2, 5},
+	{"a{2,3}", "aaaaa", 0, 3},
+	{"a{2,3}?", "aaaaa", 0, 2},
+	{"a{,2}", "a{,2}", 0, 5},
+	{"(?:ab)+", "xababa", 1, 4},
+	{"(a*)*b", "aaab", 0, 4},
+	{"(a*)+$", "aab", 3, 0},
+	{"\\(\\)", "f()", 1, 2},
+	{"a|", "b", 0, 0},
+	{"foo(bar|baz)+", "foobaz foobarbazx", 0, 6},
+	{"needle", "haystack", -1, 0},
+	{"needle.*end", "a needle and end, end", 2, 19},
+	// An iteration matching the empty string ends its repetition.
+	{"((?:(a|b))?\?)*", "b1", 0, 0},
+	{"(?:(?:[ab])*?)+", "ab", 0, 0},
+	{"(?:|a)*", "aa", 0, 0},
+	{"(?:|a)+", "aa", 0, 0},
+	{"(b|[ab]||c)*", "ac11", 0, 1},
+	{"(?:|a){0,2}x", "ax", 0, 2},
+};
+
+static const char *const invalid[] = {
+	"(", ")", "a)", "(?", "(?=a)", "a|*", "[a", "[z-a]", "*a", "+", "\\q",
+	"\\", "a{2,1}", "a{1001}", "\\x4", "((((a)",
+	// Too many instructions once nested in loops repeating the empty string.
+	"(?:(?:(?:(?:(?:(?:(?:(?:(?:(?:(?:a?){1000})*)*)*)*)*)*)*)*)*)*",
+};
+
+TEST_DEFINE(stxre_cases)
+{
+	stxre *re;
+	spx m;
+	size_t i;
+
+	for (i=0; i<sizeof(cases) / sizeof(*cases); ++i) {
+		const struct want *w = cases + i;
+		spx text = SP(w->text);
+		int ret;
+
+		TEST_ASSERT(0 == stxrecomp(&re, SP(w->pattern)));
+		ret = stxrefind(re, text, &m, 1);
+
+		if (-1 == w->at) {
+			TEST_ASSERT(0 == ret);
+		} else {
+			TEST_ASSERT(1 == ret);
+			TEST_ASSERT(text.mem + w->at == m.mem && (size_t)w->len == m.len);
+		}
+
+		stxrefree(re);
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxre_invalid)
+{
+	stxre *re;
+	size_t i;
+
+	for (i=0; i<sizeof(invalid) / sizeof(*invalid); ++i)
+		TEST_ASSERT(-1 == stxrecomp(&re, SP(invalid[i])));
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxre_groups)
+{
+	spx text = SP("key = value; other=1");
+	spx m[4];
+	stxre *re;
+
+	TEST_ASSERT(0 == stxrecomp(&re, SP("(\\w+) *= *(\\w+)(x)?")));
+	TEST_ASSERT(3 == stxregroups(re));
+	TEST_ASSERT(1 == stxrefind(re, text, m, 4));
+	TEST_ASSERT(stxcmp(m[0], SP("key = value")));
+	TEST_ASSERT(stxcmp(m[1], SP("key")));
+	TEST_ASSERT(stxcmp(m[2], SP("value")));
+	// Groups that took no part in the match are NULL.
+	TEST_ASSERT(!m[3].mem);
+
+	// The last repetition is captured, and extra slots are cleared.
+	text = stxslice(text, 12, text.len);
+	TEST_ASSERT(1 == stxrefind(re, text, m, 4));
+	TEST_ASSERT(stxcmp(m[1], SP("other")) && stxcmp(m[2], SP("1")));
+	stxrefree(re);
+
+	TEST_ASSERT(0 == stxrecomp(&re, SP("(a|b)+(c)?")));
+	TEST_ASSERT(1 == stxrefind(re, SP("xabab"), m, 4));
+	TEST_ASSERT(stxcmp(m[0], SP("abab")) && stxcmp(m[1], SP("b")));
+	TEST_ASSERT(!m[2].mem && !m[3].mem);
+	TEST_ASSERT(0 == stxrefind(re, SP("xyz"), m, 4));
+	TEST_ASSERT(!m[0].mem);
+	stxrefree(re);
+
+	// Groups of the iteration matching the empty string are kept.
+	text = SP("b1");
+	TEST_ASSERT(0 == stxrecomp(&re, SP("((?:(a|b))?\?)*")));
+	TEST_ASSERT(1 == stxrefind(re, text, m, 4));
+	TEST_ASSERT(text.mem == m[0].mem && 0 == m[0].len);
+	TEST_ASSERT(text.mem == m[1].mem && 0 == m[1].len);
+	TEST_ASSERT(!m[2].mem);
+	stxrefree(re);
+
+	text = SP("aa");
+	TEST_ASSERT(0 == stxrecomp(&re, SP("(a|)*")));
+	TEST_ASSERT(1 == stxrefind(re, text, m, 2));
+	TEST_ASSERT(stxcmp(m[0], SP("aa")));
+	TEST_ASSERT(text.mem + 2 == m[1].mem && 0 == m[1].len);
+	stxrefree(re);
+
+	text = SP("ba");
+	TEST_ASSERT(0 == stxrecomp(&re, SP("((b)?\?){0,2}a")));
+	TEST_ASSERT(1 == stxrefind(re, text, m, 3));
+	TEST_ASSERT(stxcmp(m[0], SP("ba")));
+	TEST_ASSERT(text.mem + 1 == m[1].mem && 0 == m[1].len);
+	TEST_ASSERT(stxcmp(m[2], SP("b")));
+	stxrefree(re);
+
+	TEST_END;
+}
+
+// Random patterns over "ab", whose match must be the same whether found by
+// the DFAs alone or with submatches.
+TEST_DEFINE(stxre_random)
+{
+	static const char *const atoms[] = {
+		"a", "b", ".", "[ab]", "(a|b)", "(ab|a)", "(a*)", "(b?)", "^", "$",
+	};
+	static const char *const ops[] = {"", "", "*", "+", "?", "*?", "{1,2}"};
+	char pattern[128], text[64];
+	spx m1, m[3];
+	stxre *re;
+	int i, k, n;
+
+	for (i=0; i<2000; ++i) {
+		pattern[0] = '\0';
+		n = test_rand(1, 6);
+		for (k=0; k<n; ++k) {
+			strcat(pattern, "(");
+			strcat(pattern, atoms[rand() % (sizeof(atoms) / sizeof(*atoms))]);
+			strcat(pattern, ")");
+			strcat(pattern, ops[rand() % (sizeof(ops) / sizeof(*ops))]);
+		}
+
+		n = test_rand(0, sizeof(text) - 1);
+		for (k=0; k<n; ++k)
+			text[k] = "abc"[rand() % 3];
+
+		TEST_ASSERT(0 == stxrecomp(&re, SP(pattern)));
+		k = stxrefind(re, (spx){.mem = text, .len = n}, &m1, 1);
+		TEST_ASSERT(k == stxrefind(re, (spx){.mem = text, .len = n}, m, 3));
+		TEST_ASSERT(m1.mem == m[0].mem && m1.len == m[0].len);
+		stxrefree(re);
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxre_linear)
+{
+	size_t n = 1 << 20;
+	size_t i;
+	char *text = malloc(n);
+	stxre *re;
+	spx m;
+
+	TEST_ASSERT(text);
+	memset(text, 'a', n);
+
+	// Backtracking takes exponential time on these.
+	TEST_ASSERT(0 == stxrecomp(&re, SP("(a*)*b")));
+	TEST_ASSERT(0 == stxrefind(re, (spx){.mem = text, .len = n}, &m, 1));
+	stxrefree(re);
+
+	// Many more DFA states than the cache holds.
+	test_rand_bytes(text, n);
+	for (i=0; i<n; ++i)
+		text[i] = 'a' + (text[i] & 1);
+	TEST_ASSERT(0 == stxrecomp(&re, SP("a[ab]{14}c")));
+	TEST_ASSERT(0 == stxrefind(re, (spx){.mem = text, .len = n}, &m, 1));
+	text[n - 16] = 'a';
+	text[n - 1] = 'c';
+	TEST_ASSERT(1 == stxrefind(re, (spx){.mem = text, .len = n}, &m, 1));
+	TEST_ASSERT(16 == m.len && 'c' == m.mem[15]);
+	stxrefree(re);
+
+	// The prefix is searched for before the DFA runs.
+	memset(text, 'x', n);
+	memcpy(text + n - 10, "prefix=42;", 10);
+	TEST_ASSERT(0 == stxrecomp(&re, SP("prefix=(\\d+)")));
+	TEST_ASSERT(1 == stxrefind(re, (spx){.mem = text, .len = n}, &m, 1));
+	TEST_ASSERT(text + n - 10 == m.mem && 9 == m.len);
+	stxrefree(re);
+
+	free(text);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxre_cases);
+	TEST_RUN(ts, stxre_invalid);
+	TEST_RUN(ts, stxre_groups);
+	TEST_RUN(ts, stxre_random);
+	TEST_RUN(ts, stxre_linear);
+	TEST_PRINT(ts);
+}
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+static spx
+ref(const char *str)
+{
+	spx sp = {.mem = str, .len = strlen(str)};
+	return sp;
+}
+
+static bool
+equals(const stx *sp, const char *str)
+{
+	return stxcmp(stxref(sp), ref(str));
+}
+
+TEST_DEFINE(stxreplace_none)
+{
+	stx s1;
+
+	stxdup_str(&s1, "hello world");
+
+	TEST_ASSERT(0 == stxreplace(&s1, ref("xyz"), ref("abc"), SIZE_MAX));
+	TEST_ASSERT(equals(&s1, "hello world"));
+	TEST_ASSERT(0 == stxreplace(&s1, ref(""), ref("abc"), SIZE_MAX));
+	TEST_ASSERT(equals(&s1, "hello world"));
+	TEST_ASSERT(0 == stxreplace(&s1, ref("o"), ref("abc"), 0));
+	TEST_ASSERT(equals(&s1, "hello world"));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxreplace_shrink)
+{
+	stx s1;
+	char *p;
+
+	stxdup_str(&s1, "a<br>b<br><br>c<br>");
+	p = s1.mem;
+
+	TEST_ASSERT(0 == stxreplace(&s1, ref("<br>"), ref("\n"), SIZE_MAX));
+	TEST_ASSERT(equals(&s1, "a\nb\n\nc\n"));
+	TEST_ASSERT(p == s1.mem);
+
+	TEST_ASSERT(0 == stxreplace(&s1, ref("\n"), ref(""), 2));
+	TEST_ASSERT(equals(&s1, "ab\nc\n"));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxreplace_grow)
+{
+	stx s1;
+
+	stxdup_str(&s1, "x&y&&z&");
+
+	TEST_ASSERT(0 == stxreplace(&s1, ref("&"), ref("&amp;"), SIZE_MAX));
+	TEST_ASSERT(equals(&s1, "x&amp;y&amp;&amp;z&amp;"));
+	TEST_ASSERT(s1.len == s1.size);
+
+	TEST_ASSERT(0 == stxreplace(&s1, ref("amp"), ref("ampere"), 1));
+	TEST_ASSERT(equals(&s1, "x&ampere;y&amp;&amp;z&amp;"));
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxreplace_grow_many)
+{
+	stx s1;
+	stx s2;
+	int i;
+
+	stxalloc(&s1, 2000);
+	stxalloc(&s2, 4000);
+
+	// More matches than fit in the offsets kept on the stack.
+	for (i=0; i<1000; ++i) {
+		stxapp_str(&s1, i % 3 ? "ab" : "a");
+		stxapp_str(&s2, i % 3 ? "<a>b" : "<a>");
+	}
+
+	TEST_ASSERT(0 == stxreplace(&s1, ref("a"), ref("<a>"), SIZE_MAX));
+	TEST_ASSERT(stxcmp(stxref(&s1), stxref(&s2)));
+
+	stxfree(&s1);
+	stxfree(&s2);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxreplace_shared)
+{
+	stx s1;
+	stx s2;
+
+	stxdup_str(&s1, "one two one");
+	stxshare(&s2, &s1);
+
+	TEST_ASSERT(0 == stxreplace(&s2, ref("one"), ref("1"), SIZE_MAX));
+	TEST_ASSERT(0 == stxreplace(&s1, ref("two"), ref("three"), SIZE_MAX));
+	TEST_ASSERT(equals(&s2, "1 two 1"));
+	TEST_ASSERT(equals(&s1, "one three one"));
+
+	stxfree(&s1);
+	stxfree(&s2);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxreplace_none);
+	TEST_RUN(ts, stxreplace_shrink);
+	TEST_RUN(ts, stxreplace_grow);
+	TEST_RUN(ts, stxreplace_grow_many);
+	TEST_RUN(ts, stxreplace_shared);
+	TEST_PRINT(ts);
+}
@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+// Random strings generated for the test.
+char rb1[1024];
+char rb2[1024];
+
+TEST_DEFINE(stxshare_zero)
+{
+	stx s1 = {0};
+	stx s2;
+
+	TEST_ASSERT(0 == stxshare(&s2, &s1));
+	TEST_ASSERT(NULL == s1.rc);
+	TEST_ASSERT(NULL == s2.rc);
+	TEST_ASSERT(NULL == s2.mem);
+	TEST_ASSERT(0 == s2.len);
+	TEST_ASSERT(0 == s2.size);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxunshare_empty)
+{
+	stx s1 = {.mem = malloc(1)};
+	stx s2;
+
+	// Memory of size 0 is dropped instead of copied.
+	TEST_ASSERT(0 == stxshare(&s2, &s1));
+	TEST_ASSERT(0 == stxunshare(&s2));
+	TEST_ASSERT(NULL == s2.mem);
+	TEST_ASSERT(NULL == s2.rc);
+	TEST_ASSERT(0 == s2.size);
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxshare_no_copy)
+{
+	stx s1;
+	stx s2;
+	stx s3;
+
+	stxdup_mem(&s1, rb1, sizeof(rb1));
+
+	TEST_ASSERT(0 == stxshare(&s2, &s1));
+	TEST_ASSERT(0 == stxshare(&s3, &s2));
+	TEST_ASSERT(s1.mem == s2.mem);
+	TEST_ASSERT(s1.mem == s3.mem);
+	TEST_ASSERT(s1.rc == s3.rc);
+	TEST_ASSERT(sizeof(rb1) == s3.len);
+	TEST_ASSERT(sizeof(rb1) == s3.size);
+
+	stxfree(&s1);
+	stxfree(&s2);
+	stxfree(&s3);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxshare_copy_on_write)
+{
+	stx s1;
+	stx s2;
+
+	stxdup_mem(&s1, rb1, sizeof(rb1));
+	stxshare(&s2, &s1);
+
+	TEST_ASSERT(&s2 == stxcpy_mem(&s2, rb2, sizeof(rb2)));
+	TEST_ASSERT(s1.mem != s2.mem);
+	TEST_ASSERT(NULL == s2.rc);
+	TEST_ASSERT(0 == memcmp(s1.mem, rb1, sizeof(rb1)));
+	TEST_ASSERT(0 == memcmp(s2.mem, rb2, sizeof(rb2)));
+
+	// The last reference writes without copying.
+	char *p = s1.mem;
+	TEST_ASSERT(&s1 == stxlstrip(&s1, rb1, 1));
+	TEST_ASSERT(p == s1.mem);
+	TEST_ASSERT(NULL == s1.rc);
+
+	stxfree(&s1);
+	stxfree(&s2);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxshare_grow)
+{
+	stx s1;
+	stx s2;
+
+	stxdup_mem(&s1, rb1, sizeof(rb1));
+	stxshare(&s2, &s1);
+
+	TEST_ASSERT(0 == stxgrow(&s2, sizeof(rb2)));
+	TEST_ASSERT(&s2 == stxapp_mem(&s2, rb2, sizeof(rb2)));
+	TEST_ASSERT(s1.mem != s2.mem);
+	TEST_ASSERT(sizeof(rb1) == s1.len);
+	TEST_ASSERT(sizeof(rb1) + sizeof(rb2) == s2.len);
+	TEST_ASSERT(0 == memcmp(s2.mem, rb1, sizeof(rb1)));
+	TEST_ASSERT(0 == memcmp(s2.mem + sizeof(rb1), rb2, sizeof(rb2)));
+
+	stxfree(&s1);
+	stxfree(&s2);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	test_rand_bytes(rb1, sizeof(rb1));
+	test_rand_bytes(rb2, sizeof(rb2));
+
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxshare_zero);
+	TEST_RUN(ts, stxunshare_empty);
+	TEST_RUN(ts, stxshare_no_copy);
+	TEST_RUN(ts, stxshare_copy_on_write);
+	TEST_RUN(ts, stxshare_grow);
+	TEST_PRINT(ts);
+}
@@ -0,0 +1,116 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "../libstx.h"
+#include "test.h"
+
+static struct stxstats before;
+
+static void *
+work(void *arg)
+{
+	stx s1;
+
+	(void)arg;
+
+	stxalloc(&s1, 16);
+	stxgrow(&s1, 100);
+	stxcpy_str(&s1, "  tail");
+	stxins_str(&s1, 2, "head");
+	stxlstrip(&s1, " ", 1);
+	stxfree(&s1);
+
+	return NULL;
+}
+
+TEST_DEFINE(stxstats_counts)
+{
+	struct stxstats after;
+	pthread_t th;
+
+	if (-1 == stxstats_snapshot(&before)) {
+		// Built without LIBSTX_STATS.
+		TEST_ASSERT(0 == before.allocs);
+		TEST_ASSERT(0 == before.calls[STXSTATS_ALLOC]);
+		TEST_END;
+	}
+
+	work(NULL);
+
+	// Counters of exited threads are kept.
+	TEST_ASSERT(0 == pthread_create(&th, NULL, work, NULL));
+	TEST_ASSERT(0 == pthread_join(th, NULL));
+
+	TEST_ASSERT(0 == stxstats_snapshot(&after));
+	TEST_ASSERT(2 == after.calls[STXSTATS_ALLOC] - before.calls[STXSTATS_ALLOC]);
+	TEST_ASSERT(2 == after.calls[STXSTATS_GROW] - before.calls[STXSTATS_GROW]);
+	TEST_ASSERT(2 == after.calls[STXSTATS_INS] - before.calls[STXSTATS_INS]);
+	TEST_ASSERT(2 == after.calls[STXSTATS_LSTRIP] - before.calls[STXSTATS_LSTRIP]);
+	TEST_ASSERT(2 == after.allocs - before.allocs);
+	TEST_ASSERT(32 == after.alloc_bytes - before.alloc_bytes);
+	TEST_ASSERT(2 == after.reallocs - before.reallocs);
+	TEST_ASSERT(232 == after.realloc_bytes - before.realloc_bytes);
+	TEST_ASSERT(2 == after.growth[6] - before.growth[6]);
+	TEST_ASSERT(4 == after.moves - before.moves);
+	// "tail" moved right for "head", then "headtail" moved left.
+	TEST_ASSERT(24 == after.move_bytes - before.move_bytes);
+
+	TEST_END;
+}
+
+static pthread_key_t late;
+
+// Created after the key of the statistics, so it runs after the record of the
+// thread is folded on most systems.
+static void
+lateuse(void *arg)
+{
+	work(arg);
+}
+
+static void *
+exiting(void *arg)
+{
+	work(NULL);
+	pthread_setspecific(late, arg);
+
+	return NULL;
+}
+
+TEST_DEFINE(stxstats_thread_exit)
+{
+	struct stxstats after;
+	pthread_t th;
+	int i;
+
+	if (-1 == stxstats_snapshot(&before))
+		TEST_END;
+
+	TEST_ASSERT(0 == pthread_key_create(&late, lateuse));
+
+	// Functions called by destructors on the way out of a thread must not
+	// count into its freed record.
+	for (i=0; i<100; ++i) {
+		TEST_ASSERT(0 == pthread_create(&th, NULL, exiting, &late));
+		TEST_ASSERT(0 == pthread_join(th, NULL));
+	}
+
+	TEST_ASSERT(0 == stxstats_snapshot(&after));
+	TEST_ASSERT(100 <= after.calls[STXSTATS_ALLOC] - before.calls[STXSTATS_ALLOC]);
+
+	pthread_key_delete(late);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxstats_counts);
+	TEST_RUN(ts, stxstats_thread_exit);
+	TEST_PRINT(ts);
+}
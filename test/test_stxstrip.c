@@ -0,0 +1,84 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+#define SP(s) ((spx){.mem = (s), .len = sizeof(s) - 1})
+
+TEST_DEFINE(stxlstrip_set)
+{
+	stx s1;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 16));
+
+	stxcpy_str(&s1, " \tab c\t ");
+	TEST_ASSERT(&s1 == stxlstrip(&s1, " \t", 2));
+	TEST_ASSERT(stxcmp(stxref(&s1), SP("ab c\t ")));
+
+	stxcpy_str(&s1, "xxx");
+	stxlstrip(&s1, "x", 1);
+	TEST_ASSERT(0 == s1.len);
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxrstrip_set)
+{
+	stx s1;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 16));
+
+	stxcpy_str(&s1, " \tab c\t ");
+	TEST_ASSERT(&s1 == stxrstrip(&s1, " \t", 2));
+	TEST_ASSERT(stxcmp(stxref(&s1), SP(" \tab c")));
+
+	// The first byte is stripped too.
+	stxcpy_str(&s1, "xxx");
+	stxrstrip(&s1, "x", 1);
+	TEST_ASSERT(0 == s1.len);
+
+	stxcpy_str(&s1, "x");
+	stxrstrip(&s1, "x", 1);
+	TEST_ASSERT(0 == s1.len);
+
+	stxrstrip(&s1, "x", 1);
+	TEST_ASSERT(0 == s1.len);
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxstrip_set)
+{
+	stx s1;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 16));
+
+	stxcpy_str(&s1, "--a-b--");
+	TEST_ASSERT(&s1 == stxstrip(&s1, "-", 1));
+	TEST_ASSERT(stxcmp(stxref(&s1), SP("a-b")));
+
+	stxcpy_str(&s1, "-+-");
+	stxstrip(&s1, "+-", 2);
+	TEST_ASSERT(0 == s1.len);
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxlstrip_set);
+	TEST_RUN(ts, stxrstrip_set);
+	TEST_RUN(ts, stxstrip_set);
+	TEST_PRINT(ts);
+}
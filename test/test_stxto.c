@@ -0,0 +1,161 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+static spx
+ref(const char *str)
+{
+	spx sp = {.mem = str, .len = strlen(str)};
+	return sp;
+}
+
+TEST_DEFINE(stxtou64_none)
+{
+	uint64_t n = 7;
+
+	TEST_ASSERT(0 == stxtou64(ref(""), &n));
+	TEST_ASSERT(0 == stxtou64(ref("+"), &n));
+	TEST_ASSERT(0 == stxtou64(ref("-1"), &n));
+	TEST_ASSERT(0 == stxtou64(ref(" 1"), &n));
+	TEST_ASSERT(7 == n);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxtou64_rand)
+{
+	char str[32];
+	uint64_t n;
+
+	for (int i=0; i<100000; ++i) {
+		uint64_t v;
+		test_rand_bytes(&v, sizeof(v));
+		v >>= rand() % 64;
+
+		int len = snprintf(str, sizeof(str), "%" PRIu64 ",", v);
+		spx sp = {.mem = str, .len = len};
+
+		TEST_ASSERT((size_t)len - 1 == stxtou64(sp, &n));
+		TEST_ASSERT(v == n);
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxtou64_overflow)
+{
+	uint64_t n;
+
+	errno = 0;
+	TEST_ASSERT(20 == stxtou64(ref("18446744073709551615"), &n));
+	TEST_ASSERT(UINT64_MAX == n);
+	TEST_ASSERT(0 == errno);
+
+	TEST_ASSERT(25 == stxtou64(ref("1844674407370955161612345"), &n));
+	TEST_ASSERT(UINT64_MAX == n);
+	TEST_ASSERT(ERANGE == errno);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxtoi64_limits)
+{
+	int64_t n;
+
+	errno = 0;
+	TEST_ASSERT(20 == stxtoi64(ref("-9223372036854775808"), &n));
+	TEST_ASSERT(INT64_MIN == n);
+	TEST_ASSERT(20 == stxtoi64(ref("+9223372036854775807"), &n));
+	TEST_ASSERT(INT64_MAX == n);
+	TEST_ASSERT(0 == errno);
+
+	TEST_ASSERT(20 == stxtoi64(ref("-9223372036854775809"), &n));
+	TEST_ASSERT(INT64_MIN == n);
+	TEST_ASSERT(ERANGE == errno);
+
+	TEST_ASSERT(3 == stxtoi64(ref("-42abc"), &n));
+	TEST_ASSERT(-42 == n);
+	TEST_ASSERT(0 == stxtoi64(ref("-"), &n));
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxtod_known)
+{
+	static const struct {
+		const char *str;
+		size_t n;
+		double d;
+	} known[] = {
+		{"0", 1, 0.0},
+		{"1.5", 3, 1.5},
+		{"-.25x", 4, -0.25},
+		{"12.", 3, 12.0},
+		{"1e3", 3, 1000.0},
+		{"1e", 1, 1.0},
+		{"2E-2", 4, 0.02},
+		{"0.1", 3, 0.1},
+		{"9007199254740993", 16, 9007199254740993.0},
+		{"1.7976931348623157e308", 22, 1.7976931348623157e308},
+		{"4.9e-324", 8, 4.9e-324},
+		{"123456789012345678901234567890", 30, 123456789012345678901234567890.0},
+		{"Infinity", 8, 1.0 / 0.0},
+		{"-inf", 4, -1.0 / 0.0},
+	};
+	double d;
+
+	for (size_t i=0; i<sizeof(known)/sizeof(*known); ++i) {
+		TEST_ASSERT(known[i].n == stxtod(ref(known[i].str), &d));
+		TEST_ASSERT(known[i].d == d);
+	}
+
+	TEST_ASSERT(0 == stxtod(ref("."), &d));
+	TEST_ASSERT(0 == stxtod(ref("-e5"), &d));
+	TEST_ASSERT(3 == stxtod(ref("nan"), &d));
+	TEST_ASSERT(d != d);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxtod_strtod_rand)
+{
+	char str[64];
+	double d;
+
+	for (int i=0; i<100000; ++i) {
+		uint64_t bits;
+		double v;
+
+		test_rand_bytes(&bits, sizeof(bits));
+		memcpy(&v, &bits, sizeof(v));
+		if (v != v || v - v != 0)
+			continue;
+
+		int len = snprintf(str, sizeof(str), "%.*g", rand() % 17 + 1, v);
+		spx sp = {.mem = str, .len = len};
+
+		TEST_ASSERT((size_t)len == stxtod(sp, &d));
+		TEST_ASSERT(strtod(str, NULL) == d);
+	}
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxtou64_none);
+	TEST_RUN(ts, stxtou64_rand);
+	TEST_RUN(ts, stxtou64_overflow);
+	TEST_RUN(ts, stxtoi64_limits);
+	TEST_RUN(ts, stxtod_known);
+	TEST_RUN(ts, stxtod_strtod_rand);
+	TEST_PRINT(ts);
+}
@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../libstx.h"
+#include "test.h"
+
+#define SP(s) ((spx){.mem = (s), .len = sizeof(s) - 1})
+
+TEST_DEFINE(stxapp_urlenc_bytes)
+{
+	stx s1;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 1));
+	stxcpy_str(&s1, "x");
+
+	TEST_ASSERT(0 == stxapp_urlenc(&s1, SP("aZ09-._~ /?&=+%\0\xFF"), 0));
+	TEST_ASSERT(stxcmp(stxref(&s1), SP("xaZ09-._~%20%2F%3F%26%3D%2B%25%00%FF")));
+
+	s1.len = 0;
+	TEST_ASSERT(0 == stxapp_urlenc(&s1, SP("a b+c"), STXURL_PLUS));
+	TEST_ASSERT(stxcmp(stxref(&s1), SP("a+b%2Bc")));
+
+	s1.len = 0;
+	TEST_ASSERT(0 == stxapp_urlenc(&s1, SP(""), 0));
+	TEST_ASSERT(0 == s1.len);
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxapp_urlenc_runs)
+{
+	char src[300];
+	stx s1;
+	size_t n, at, i;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 1));
+
+	// A single byte to encode anywhere in runs of every length, past the
+	// blocks of the vector kernels included.
+	for (n=1; n<sizeof(src); ++n) {
+		memset(src, 'a', n);
+		at = rand() % n;
+		src[at] = " /\x80\x7F"[rand() % 4];
+
+		s1.len = 0;
+		TEST_ASSERT(0 == stxapp_urlenc(&s1, (spx){.mem = src, .len = n}, 0));
+		TEST_ASSERT(n + 2 == s1.len);
+		TEST_ASSERT('%' == s1.mem[at]);
+		for (i=0; i<at; ++i)
+			TEST_ASSERT('a' == s1.mem[i]);
+	}
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxapp_urldec_escapes)
+{
+	static const char *const invalid[] = {
+		"%", "a%", "%2", "%2g", "%g2", "a%%20",
+	};
+	stx s1;
+	size_t i;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 16));
+
+	TEST_ASSERT(0 == stxapp_urldec(&s1, SP("a%20b%2fc%2F+%00%fF"), 0));
+	TEST_ASSERT(stxcmp(stxref(&s1), SP("a b/c/+\0\xFF")));
+
+	s1.len = 0;
+	TEST_ASSERT(0 == stxapp_urldec(&s1, SP("a+b%2B+"), STXURL_PLUS));
+	TEST_ASSERT(stxcmp(stxref(&s1), SP("a b+ ")));
+
+	// Nothing is appended when an escape is invalid.
+	s1.len = 0;
+	stxcpy_str(&s1, "kept");
+	for (i=0; i<sizeof(invalid) / sizeof(*invalid); ++i) {
+		TEST_ASSERT(-1 == stxapp_urldec(&s1, (spx){.mem = invalid[i], .len = strlen(invalid[i])}, STXURL_PLUS));
+		TEST_ASSERT(stxcmp(stxref(&s1), SP("kept")));
+	}
+
+	stxfree(&s1);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxurl_roundtrip)
+{
+	char src[1000];
+	stx s1, s2;
+	size_t n;
+	int i, flags;
+
+	TEST_ASSERT(0 == stxalloc(&s1, 1));
+	TEST_ASSERT(0 == stxalloc(&s2, 1));
+
+	for (i=0; i<200; ++i) {
+		n = test_rand(0, sizeof(src));
+		test_rand_bytes(src, n);
+		flags = i % 2 ? STXURL_PLUS : 0;
+
+		s1.len = 0;
+		s2.len = 0;
+		TEST_ASSERT(0 == stxapp_urlenc(&s1, (spx){.mem = src, .len = n}, flags));
+		TEST_ASSERT(0 == stxapp_urldec(&s2, stxref(&s1), flags));
+		TEST_ASSERT(n == s2.len && 0 == memcmp(src, s2.mem, n));
+	}
+
+	stxfree(&s1);
+	stxfree(&s2);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxquery_pairs)
+{
+	spx q = SP("a=1&&b=x%20y&flag&c=&=v&d=p+q=r&");
+	stxkv kvs[8];
+	size_t n;
+
+	n = stxquery(q, kvs, 8);
+	TEST_ASSERT(6 == n);
+
+	TEST_ASSERT(stxcmp(kvs[0].key, SP("a")) && stxcmp(kvs[0].val, SP("1")));
+	TEST_ASSERT(!kvs[0].enc);
+	TEST_ASSERT(stxcmp(kvs[1].key, SP("b")) && stxcmp(kvs[1].val, SP("x%20y")));
+	TEST_ASSERT(kvs[1].enc);
+	TEST_ASSERT(stxcmp(kvs[2].key, SP("flag")) && 0 == kvs[2].val.len);
+	TEST_ASSERT(!kvs[2].enc);
+	TEST_ASSERT(stxcmp(kvs[3].key, SP("c")) && 0 == kvs[3].val.len);
+	TEST_ASSERT(0 == kvs[4].key.len && stxcmp(kvs[4].val, SP("v")));
+	TEST_ASSERT(stxcmp(kvs[5].key, SP("d")) && stxcmp(kvs[5].val, SP("p+q=r")));
+	TEST_ASSERT(kvs[5].enc);
+
+	// Pairs and values refer to the query.
+	TEST_ASSERT(q.mem + 2 == kvs[0].val.mem);
+
+	// Pairs past "n" are counted only.
+	memset(kvs, 0, sizeof(kvs));
+	TEST_ASSERT(6 == stxquery(q, kvs, 2));
+	TEST_ASSERT(stxcmp(kvs[1].key, SP("b")));
+	TEST_ASSERT(NULL == kvs[2].key.mem);
+	TEST_ASSERT(6 == stxquery(q, NULL, 0));
+
+	TEST_ASSERT(0 == stxquery(SP(""), kvs, 8));
+	TEST_ASSERT(0 == stxquery(SP("&&"), kvs, 8));
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxapp_urlenc_bytes);
+	TEST_RUN(ts, stxapp_urlenc_runs);
+	TEST_RUN(ts, stxapp_urldec_escapes);
+	TEST_RUN(ts, stxurl_roundtrip);
+	TEST_RUN(ts, stxquery_pairs);
+	TEST_PRINT(ts);
+}
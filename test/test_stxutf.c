@@ -5,6 +5,19 @@
 #include "../libstx.h"
 #include "test.h"
 
+TEST_DEFINE(stxutf8len_count)
+{
+	// "aé€😀1 " is 6 code points in 1, 2, 3, 4, 1 and 1 bytes.
+	const char s[] = "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80" "1 ";
+
+	TEST_ASSERT(6 == stxutf8len((spx){.mem = s, .len = sizeof(s) - 1}));
+	TEST_ASSERT(5 == stxutf8len((spx){.mem = "hello", .len = 5}));
+	TEST_ASSERT(3 == stxutf8len((spx){.mem = "1 +", .len = 3}));
+	TEST_ASSERT(0 == stxutf8len((spx){.mem = "", .len = 0}));
+
+	TEST_END;
+}
+
 TEST_DEFINE(stxutf8n32_1byte)
 {
 	for (uint32_t wc=0; wc<128; ++wc) {
@@ -34,7 +47,7 @@ TEST_DEFINE(stxutf8n32_3byte)
 
 TEST_DEFINE(stxutf8n32_4byte)
 {
-	for (uint32_t wc=0x10000; wc<0x11000; ++wc) {
+	for (uint32_t wc=0x10000; wc<0x110000; ++wc) {
 		TEST_ASSERT(4 == stxutf8n32(wc));
 	}
 
@@ -43,9 +56,10 @@ TEST_DEFINE(stxutf8n32_4byte)
 
 TEST_DEFINE(stxutf8n32_outside_range_quick)
 {
-	for (uint32_t wc=0x11000; wc<0xFFFFF; ++wc) {
+	for (uint32_t wc=0x110000; wc<0x1FFFFF; ++wc) {
 		TEST_ASSERT(0 == stxutf8n32(wc));
 	}
+	TEST_ASSERT(0 == stxutf8n32(UINT32_MAX));
 
 	TEST_END;
 }
@@ -119,11 +133,74 @@ TEST_DEFINE(stxutf8f32_4byte)
 	TEST_END;
 }
 
+static spx
+ref(const char *str)
+{
+	spx sp = {.mem = str, .len = strlen(str)};
+	return sp;
+}
+
+TEST_DEFINE(stxutf8len_mixed)
+{
+	TEST_ASSERT(0 == stxutf8len(ref("")));
+	TEST_ASSERT(5 == stxutf8len(ref("hello")));
+	TEST_ASSERT(5 == stxutf8len(ref("w\xC3\xB6rld")));
+	TEST_ASSERT(3 == stxutf8len(ref("\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E")));
+	TEST_ASSERT(6 == stxutf8len(ref("emoji\xF0\x9F\x98\x80")));
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxutf8valid_encodings)
+{
+	char buf[4];
+	uint32_t wc;
+	size_t n;
+
+	// Every code point encodes to valid utf8, except surrogates.
+	for (wc=0; wc<0x110000; wc += 1 + rand() % 16) {
+		n = stxutf8n32(wc);
+		if (!n)
+			continue;
+		stxutf8f32(buf, wc, n);
+		TEST_ASSERT((wc >= 0xD800 && wc <= 0xDFFF) !=
+			stxutf8valid((spx){.mem = buf, .len = n}));
+	}
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxutf8valid_invalid)
+{
+	TEST_ASSERT(stxutf8valid(ref("")));
+	TEST_ASSERT(stxutf8valid(ref("plain ASCII text, longer than a word")));
+	TEST_ASSERT(stxutf8valid(ref("caf\xC3\xA9 \xF4\x8F\xBF\xBF")));
+
+	// Lone continuation bytes, truncated and overlong encodings.
+	TEST_ASSERT(!stxutf8valid(ref("\x80")));
+	TEST_ASSERT(!stxutf8valid(ref("abcdefgh\xBF")));
+	TEST_ASSERT(!stxutf8valid(ref("caf\xC3")));
+	TEST_ASSERT(!stxutf8valid(ref("\xE2\x82")));
+	TEST_ASSERT(!stxutf8valid(ref("\xE2\x82x")));
+	TEST_ASSERT(!stxutf8valid(ref("\xC0\xAF")));
+	TEST_ASSERT(!stxutf8valid(ref("\xC1\xBF")));
+	TEST_ASSERT(!stxutf8valid(ref("\xE0\x80\xAF")));
+	TEST_ASSERT(!stxutf8valid(ref("\xF0\x80\x80\xAF")));
+	// Surrogates, code points past 0x10FFFF and bytes never used.
+	TEST_ASSERT(!stxutf8valid(ref("\xED\xA0\x80")));
+	TEST_ASSERT(!stxutf8valid(ref("\xF4\x90\x80\x80")));
+	TEST_ASSERT(!stxutf8valid(ref("\xF5\x80\x80\x80")));
+	TEST_ASSERT(!stxutf8valid(ref("\xFF")));
+
+	TEST_END;
+}
+
 int
 main(void)
 {
 	srand(time(NULL));
 	TEST_INIT(ts);
+	TEST_RUN(ts, stxutf8len_count);
 	TEST_RUN(ts, stxutf8n32_1byte);
 	TEST_RUN(ts, stxutf8n32_2byte);
 	TEST_RUN(ts, stxutf8n32_3byte);
@@ -133,5 +210,8 @@ main(void)
 	TEST_RUN(ts, stxutf8f32_2byte);
 	TEST_RUN(ts, stxutf8f32_3byte);
 	TEST_RUN(ts, stxutf8f32_4byte);
+	TEST_RUN(ts, stxutf8len_mixed);
+	TEST_RUN(ts, stxutf8valid_encodings);
+	TEST_RUN(ts, stxutf8valid_invalid);
 	TEST_PRINT(ts);
 }
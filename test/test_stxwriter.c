@@ -0,0 +1,180 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../libstx.h"
+#include "test.h"
+
+#define THREADS 4
+#define LINES 5000
+
+static stxwriter *w;
+
+static void *
+produce(void *arg)
+{
+	uint64_t id = (uintptr_t)arg;
+	uint64_t i;
+
+	for (i=0; i<LINES; ++i) {
+		stx *sp = stxwriterget(w, 64);
+
+		if (!sp)
+			return arg;
+
+		stxapp_u64(sp, id);
+		stxapp_str(sp, " ");
+		stxapp_u64(sp, i);
+		stxapp_str(sp, "\n");
+		stxwriterput(w);
+	}
+
+	return NULL;
+}
+
+static size_t
+readback(int fd, char *buf, size_t n)
+{
+	ssize_t len = pread(fd, buf, n, 0);
+
+	return len < 0 ? 0 : len;
+}
+
+TEST_DEFINE(stxwriter_order)
+{
+	char path[] = "/tmp/test_stxwriterXXXXXX";
+	static char out[THREADS * LINES * 32];
+	stxwriteropts opts = {.size = 256, .nbufs = 3, .sync = STXSYNC_FLUSH};
+	uint64_t next[THREADS] = {0};
+	pthread_t th[THREADS];
+	spx rest;
+	int fd;
+	size_t i;
+
+	TEST_ASSERT(-1 != (fd = mkstemp(path)));
+	unlink(path);
+	TEST_ASSERT(0 == stxwriteropen(&w, fd, &opts));
+
+	for (i=0; i<THREADS; ++i)
+		TEST_ASSERT(0 == pthread_create(th + i, NULL, produce, (void *)i));
+	for (i=0; i<THREADS; ++i) {
+		void *ret;
+
+		TEST_ASSERT(0 == pthread_join(th[i], &ret));
+		TEST_ASSERT(NULL == ret);
+	}
+
+	TEST_ASSERT(0 == stxwriterclose(w));
+
+	// Each line is whole and the lines of each thread are in order.
+	rest.mem = out;
+	rest.len = readback(fd, out, sizeof(out));
+	for (i=0; i<THREADS * LINES; ++i) {
+		spx line = stxtok(&rest, "\n", 1);
+		uint64_t id, n;
+		size_t used = stxtou64(line, &id);
+
+		TEST_ASSERT(used && id < THREADS);
+		line = stxslice(line, used + 1, line.len);
+		TEST_ASSERT(line.len == stxtou64(line, &n));
+		TEST_ASSERT(next[id]++ == n);
+	}
+	TEST_ASSERT(0 == rest.len);
+
+	close(fd);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxwriter_flush)
+{
+	char path[] = "/tmp/test_stxwriterXXXXXX";
+	char out[8192];
+	stx *sp;
+	int fd;
+
+	TEST_ASSERT(-1 != (fd = mkstemp(path)));
+	unlink(path);
+	TEST_ASSERT(0 == stxwriteropen(&w, fd, NULL));
+
+	TEST_ASSERT((sp = stxwriterget(w, 5)));
+	stxapp_str(sp, "hello");
+	stxwriterput(w);
+	TEST_ASSERT(0 == readback(fd, out, sizeof(out)));
+	TEST_ASSERT(0 == stxwriterflush(w));
+	TEST_ASSERT(5 == readback(fd, out, sizeof(out)));
+
+	// Larger than a buffer.
+	TEST_ASSERT((sp = stxwriterget(w, 100000)));
+	TEST_ASSERT(100000 <= stxavail(sp));
+	memset(sp->mem, 'x', 100000);
+	sp->len = 100000;
+	stxwriterput(w);
+	TEST_ASSERT(0 == stxwriterflush(w));
+	TEST_ASSERT(sizeof(out) == readback(fd, out, sizeof(out)));
+
+	TEST_ASSERT(0 == stxwriterclose(w));
+	close(fd);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxwriter_interval)
+{
+	char path[] = "/tmp/test_stxwriterXXXXXX";
+	stxwriteropts opts = {.interval = 10};
+	struct timespec ts = {.tv_nsec = 1000000};
+	char out[16];
+	stx *sp;
+	int fd;
+	int i;
+
+	TEST_ASSERT(-1 != (fd = mkstemp(path)));
+	unlink(path);
+	TEST_ASSERT(0 == stxwriteropen(&w, fd, &opts));
+
+	TEST_ASSERT((sp = stxwriterget(w, 3)));
+	stxapp_str(sp, "abc");
+	stxwriterput(w);
+
+	// Written without a flush once the time limit passes.
+	for (i=0; i<5000 && 0 == readback(fd, out, sizeof(out)); ++i)
+		nanosleep(&ts, NULL);
+	TEST_ASSERT(3 == readback(fd, out, sizeof(out)));
+
+	TEST_ASSERT(0 == stxwriterclose(w));
+	close(fd);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxwriter_fail)
+{
+	stx *sp;
+
+	TEST_ASSERT(0 == stxwriteropen(&w, -1, NULL));
+	TEST_ASSERT((sp = stxwriterget(w, 1)));
+	stxapp_str(sp, "x");
+	stxwriterput(w);
+	TEST_ASSERT(-1 == stxwriterflush(w));
+	TEST_ASSERT(EBADF == errno);
+	TEST_ASSERT(-1 == stxwriterclose(w));
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxwriter_order);
+	TEST_RUN(ts, stxwriter_flush);
+	TEST_RUN(ts, stxwriter_interval);
+	TEST_RUN(ts, stxwriter_fail);
+	TEST_PRINT(ts);
+}
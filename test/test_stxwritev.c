@@ -0,0 +1,69 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../libstx.h"
+#include "test.h"
+
+#define PARTS 3000
+
+static char path[] = "/tmp/test_stxwritevXXXXXX";
+static char src[1 << 16];
+static char out[PARTS * 600];
+
+TEST_DEFINE(stxwritev_parts)
+{
+	static spx parts[PARTS];
+	size_t total = 0;
+	size_t i;
+	int fd;
+
+	// Mostly tiny parts, some empty ones and a few larger than the stage.
+	test_rand_bytes(src, sizeof(src));
+	for (i=0; i<PARTS; ++i) {
+		size_t len = 0 == i % 50 ? test_rand(200, 5000) : test_rand(0, 40);
+		size_t off = test_rand(0, sizeof(src) - len);
+
+		parts[i].mem = src + off;
+		parts[i].len = len;
+		total += len;
+	}
+
+	TEST_ASSERT(-1 != (fd = mkstemp(path)));
+	unlink(path);
+
+	TEST_ASSERT(0 == stxwritev(fd, parts, PARTS));
+	TEST_ASSERT(0 == lseek(fd, 0, SEEK_SET));
+	TEST_ASSERT((ssize_t)total == read(fd, out, sizeof(out)));
+
+	for (total=0, i=0; i<PARTS; ++i) {
+		TEST_ASSERT(0 == memcmp(out + total, parts[i].mem, parts[i].len));
+		total += parts[i].len;
+	}
+
+	close(fd);
+
+	TEST_END;
+}
+
+TEST_DEFINE(stxwritev_fail)
+{
+	spx part = {.mem = "x", .len = 1};
+
+	TEST_ASSERT(0 == stxwritev(-1, &part, 0));
+	TEST_ASSERT(-1 == stxwritev(-1, &part, 1));
+
+	TEST_END;
+}
+
+int
+main(void)
+{
+	srand(time(NULL));
+	TEST_INIT(ts);
+	TEST_RUN(ts, stxwritev_parts);
+	TEST_RUN(ts, stxwritev_fail);
+	TEST_PRINT(ts);
+}